@@ -1,4 +1,6 @@
 #include <meshtools/ao/ao.hpp>
+#include <meshtools/ao/coverage.hpp>
+#include <meshtools/ao/shard.hpp>
 #include <meshtools/file.hpp>
 #include <meshtools/image.hpp>
 #include <meshtools/logging.hpp>
@@ -17,22 +19,92 @@ struct Options {
     std::filesystem::path output;
     std::filesystem::path outputDump;
     std::filesystem::path outputTexture;
+    bool ktx2;
     uint32_t resolution;
     uint8_t blurKernelSize;
+    uint32_t denoise;
+    size_t threads;
+    int samples;
+    bool adaptive;
+    float tolerance;
+    ao::Sampler sampler;
+    bool conservative;
+    uint32_t gutter;
+    bool vertex;
+    float vertexOffset;
+    bool averageTriangles;
+    ao::BuildQuality buildQuality;
+    bool compactScene;
+    bool robustScene;
+    bool tiled;
+    size_t memoryBudget;
+    std::filesystem::path job;
+    uint32_t shards;
+    int shard;
+    bool merge;
+    std::filesystem::path checkpoint;
+    bool resume;
+    std::filesystem::path coverage;
     bool verbose;
 };
 
+ao::Sampler parseSampler(const std::string& sampler) {
+    if (sampler == "random") {
+        return ao::Sampler::RANDOM;
+    } else if (sampler == "halton") {
+        return ao::Sampler::HALTON;
+    } else if (sampler == "sobol") {
+        return ao::Sampler::SOBOL;
+    }
+    throw cxxopts::exceptions::exception("Unknown sampler: " + sampler);
+}
+
+ao::BuildQuality parseBuildQuality(const std::string& quality) {
+    if (quality == "low") {
+        return ao::BuildQuality::LOW;
+    } else if (quality == "medium") {
+        return ao::BuildQuality::MEDIUM;
+    } else if (quality == "high") {
+        return ao::BuildQuality::HIGH;
+    }
+    throw cxxopts::exceptions::exception("Unknown build quality: " + quality);
+}
+
 Options parseOpts(int argc, char** argv) {
     cxxopts::Options options(argv[0], "ao-cli");
 
     // clang-format off
     options.add_options()
-            ("i,input", "Input model file", cxxopts::value<std::string>())
+            ("i,input", "Input model file", cxxopts::value<std::string>()->default_value(""))
             ("o,output-file", "Output model file", cxxopts::value<std::string>()->default_value(""))
             ("d,output-dump", "Output dump model file (only the basics, no merge)", cxxopts::value<std::string>()->default_value(""))
             ("t, output-texture", "Output texture file separately", cxxopts::value<std::string>()->default_value(""))
+            ("ktx2", "Write the texture as BC4 compressed KTX2 with mipmaps instead of PNG (KHR_texture_basisu in the model)", cxxopts::value<bool>()->default_value("false"))
             ("r,resolution", "Output texture resolution", cxxopts::value<uint32_t>()->default_value("0"))
             ("b,blur", "Blur kernel size", cxxopts::value<uint8_t>()->default_value("5"))
+            ("denoise", "Edge-avoiding denoise passes before the blur, for low sample counts (0 = off)", cxxopts::value<uint32_t>()->default_value("0"))
+            ("j,threads", "Number of bake threads (0 = all cores)", cxxopts::value<size_t>()->default_value("0"))
+            ("s,samples", "(Maximum) number of rays per texel", cxxopts::value<int>()->default_value("128"))
+            ("adaptive", "Stop tracing texels early once their AO value has converged", cxxopts::value<bool>()->default_value("false"))
+            ("tolerance", "Adaptive sampling tolerance", cxxopts::value<float>()->default_value("0.02"))
+            ("sampler", "Hemisphere sampler: random, halton or sobol", cxxopts::value<std::string>()->default_value("random"))
+            ("conservative", "Bake every texel that a triangle touches, not only the ones it covers the center of", cxxopts::value<bool>()->default_value("false"))
+            ("gutter", "Fill this many texels around the atlas charts", cxxopts::value<uint32_t>()->default_value("0"))
+            ("vertex", "Bake AO into the vertex colors instead of a texture (no UV atlas)", cxxopts::value<bool>()->default_value("false"))
+            ("vertex-offset", "Distance off the surface that vertex rays start from", cxxopts::value<float>()->default_value("0.01"))
+            ("average-triangles", "Trace vertices from inside each of their triangles and average the results", cxxopts::value<bool>()->default_value("false"))
+            ("build-quality", "BVH build quality: low, medium or high", cxxopts::value<std::string>()->default_value("medium"))
+            ("compact-scene", "Use less memory for the BVH, at the cost of trace speed", cxxopts::value<bool>()->default_value("false"))
+            ("robust-scene", "Avoid missed hits at shared edges and vertices, at the cost of trace speed", cxxopts::value<bool>()->default_value("false"))
+            ("tiled", "Bake and write the texture in bands, for maps that don't fit into memory (needs -t)", cxxopts::value<bool>()->default_value("false"))
+            ("memory-budget", "Memory budget in MB for tiled bakes", cxxopts::value<size_t>()->default_value("256"))
+            ("job", "Shard job file, for bakes that are split over several processes", cxxopts::value<std::string>()->default_value(""))
+            ("shards", "Atlas the input and write a job with this many shards", cxxopts::value<uint32_t>()->default_value("0"))
+            ("shard", "Bake this shard of the job", cxxopts::value<int>()->default_value("-1"))
+            ("merge", "Merge the baked shards of the job and write the outputs", cxxopts::value<bool>()->default_value("false"))
+            ("checkpoint", "Save the progress of the bake to this file every minute", cxxopts::value<std::string>()->default_value(""))
+            ("resume", "Continue the bake from the checkpoint, if it is of the same inputs and options", cxxopts::value<bool>()->default_value("false"))
+            ("coverage", "Cache the rasterized atlas in this file, and reuse it for bakes of the same atlased model", cxxopts::value<std::string>()->default_value(""))
             ("v,verbose", "Speak up!", cxxopts::value<bool>()->default_value("false"))
             ("h,help","Print usage");
     // clang-format on
@@ -49,11 +121,43 @@ Options parseOpts(int argc, char** argv) {
                 result["output-file"].as<std::string>(),
                 result["output-dump"].as<std::string>(),
                 result["output-texture"].as<std::string>(),
+                result["ktx2"].as<bool>(),
                 result["resolution"].as<uint32_t>(),
                 result["blur"].as<uint8_t>(),
+                result["denoise"].as<uint32_t>(),
+                result["threads"].as<size_t>(),
+                result["samples"].as<int>(),
+                result["adaptive"].as<bool>(),
+                result["tolerance"].as<float>(),
+                parseSampler(result["sampler"].as<std::string>()),
+                result["conservative"].as<bool>(),
+                result["gutter"].as<uint32_t>(),
+                result["vertex"].as<bool>(),
+                result["vertex-offset"].as<float>(),
+                result["average-triangles"].as<bool>(),
+                parseBuildQuality(result["build-quality"].as<std::string>()),
+                result["compact-scene"].as<bool>(),
+                result["robust-scene"].as<bool>(),
+                result["tiled"].as<bool>(),
+                result["memory-budget"].as<size_t>(),
+                result["job"].as<std::string>(),
+                result["shards"].as<uint32_t>(),
+                result["shard"].as<int>(),
+                result["merge"].as<bool>(),
+                result["checkpoint"].as<std::string>(),
+                result["resume"].as<bool>(),
+                result["coverage"].as<std::string>(),
                 result["verbose"].as<bool>(),
         };
 
+        if (opts.input.empty() && (opts.job.empty() || (opts.shard < 0 && !opts.merge))) {
+            throw cxxopts::exceptions::exception("No input model");
+        }
+
+        if (opts.resume && opts.checkpoint.empty()) {
+            throw cxxopts::exceptions::exception("--resume needs a --checkpoint");
+        }
+
         return opts;
     } catch (const cxxopts::exceptions::exception& e) {
         logging::error("Invalid options: {}", e.what());
@@ -90,16 +194,217 @@ void removeAmbientOcclusionTextures(models::Model& model) {
     });
 }
 
+// Filters the map (see ao::filter), adds it to the model and writes the outputs
+int writeResults(const Options& options, models::Model& model, const std::shared_ptr<Image>& image, const ao::Coverage& coverage) {
+    logging::info("Filtering. {} denoise iterations, blur kernel size {}, gutter {}", options.denoise, options.blurKernelSize, options.gutter);
+    ao::filter(*image,
+               coverage,
+               {
+                       .denoise = options.denoise,
+                       .blurKernelSize = options.blurKernelSize,
+                       .gutter = options.gutter,
+                       .threads = options.threads,
+               });
+
+    auto texture = image;
+    if (options.ktx2) {
+        logging::info("Compressing texture to KTX2");
+        texture = std::make_shared<Image>(image->ktx2(options.threads));
+    }
+
+    // Debug output
+
+    if (!options.outputDump.empty()) {
+        logging::info("Writing dump to {}", options.outputDump.c_str());
+        model.write(options.outputDump);
+    }
+
+    if (!options.outputTexture.empty()) {
+        logging::info("Writing texture to {}", options.outputTexture.c_str());
+        if (options.ktx2) {
+            file::writeFile(options.outputTexture, texture->data(), true);
+        } else {
+            file::writeFile(options.outputTexture, image->png().data(), true);
+        }
+    }
+
+    { // Update the model with the AO Map
+
+        // Remove any occlusion textures from the original
+        removeAmbientOcclusionTextures(model);
+
+        // Ensure all meshes have a material
+        model.visit([&](models::Mesh& mesh) {
+            if (mesh.materialIdx() < 0) {
+                mesh.materialIdx(model.materials().size());
+                model.materials().emplace_back();
+            }
+        });
+
+        // Set the new occlusion texture
+        // TODO: make sure the mesh is actually mapped
+        auto aoTextureIndex = model.textures().size();
+        auto aoImageIndex = model.images().size();
+        auto aoSamplerIndex = model.samplers().size();
+        // TODO: Get rid of magic numbers
+        model.samplers().push_back(models::Sampler{.minFilter = 9987, .magFilter = 9729});
+        model.images().push_back(texture);
+        model.textures().push_back(
+                models::Texture{.sampler = static_cast<int>(aoSamplerIndex), .source = static_cast<int>(aoImageIndex)});
+        for (auto& material : model.materials()) {
+            material.occlusionTexture = aoTextureIndex;
+        }
+    }
+
+    // Output
+    if (!options.output.empty()) {
+        logging::info("Writing result to {}", options.output.c_str());
+        model.write(options.output);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// Coverage of the whole map with the given options
+bool coverageMatches(const ao::Coverage& coverage, const Options& options, const Size<uint32_t>& mapSize) {
+    const auto& region = coverage.region();
+    return coverage.mapSize().width == mapSize.width && coverage.mapSize().height == mapSize.height && region.x == 0 && region.y == 0 &&
+           region.width == mapSize.width && region.height == mapSize.height && coverage.conservative() == options.conservative;
+}
+
+// Rasterizes the atlas of the whole map, or loads it from the coverage cache when that is of the same scene and
+// options
+Result<ao::Coverage> createCoverage(const Options& options, const ao::BakeScene& scene, const Size<uint32_t>& mapSize) {
+    if (!options.coverage.empty() && std::filesystem::exists(options.coverage)) {
+        auto loadResult = ao::Coverage::Load(options.coverage, scene);
+        if (!loadResult) {
+            logging::warn("Not using the coverage cache: {}", loadResult.error.c_str());
+        } else if (!coverageMatches(*loadResult.value, options, mapSize)) {
+            logging::warn("Not using the coverage cache {}, it is of a different resolution or rasterization", options.coverage.c_str());
+        } else {
+            logging::info("Using the coverage cache {}", options.coverage.c_str());
+            return loadResult;
+        }
+    }
+
+    auto coverageResult = ao::Coverage::Create(scene, mapSize, {}, options.threads, options.conservative);
+    if (coverageResult && !options.coverage.empty()) {
+        logging::info("Writing the coverage cache {}", options.coverage.c_str());
+        coverageResult.value->save(options.coverage, scene);
+    }
+    return coverageResult;
+}
+
+// Options that affect the baked values, including the scene setup
+ao::BakeOptions bakeOptions(const Options& options) {
+    return {
+            .nsamples = options.samples,
+            .threads = options.threads,
+            .adaptive = options.adaptive,
+            .tolerance = options.tolerance,
+            .conservative = options.conservative,
+            .gutter = options.gutter,
+            .sampler = options.sampler,
+            .vertexOffset = options.vertexOffset,
+            .averageTriangles = options.averageTriangles,
+            .buildQuality = options.buildQuality,
+            .compactScene = options.compactScene,
+            .robustScene = options.robustScene,
+    };
+}
+
+int bakeShard(const Options& options) {
+    auto jobResult = ao::ShardJob::Load(options.job);
+    if (!jobResult) {
+        logging::error("Could not load job {}: {}", options.job.c_str(), jobResult.error.c_str());
+        return EXIT_FAILURE;
+    }
+    const auto& job = *jobResult.value;
+
+    logging::info("Loading {}", job.model.c_str());
+    auto modelLoadResult = models::Model::Load(job.model);
+    if (!modelLoadResult) {
+        logging::error("Could not load model {}: {}", job.model.c_str(), modelLoadResult.error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    // The scene is set up as the job says, whatever the command line of this shard
+    auto sceneResult = ao::BakeScene::Create(*modelLoadResult.value, 0, job.options);
+    if (!sceneResult) {
+        logging::error("Could not set up the scene of model {}: {}", job.model.c_str(), sceneResult.error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    logging::info("Baking shard {} of {}", options.shard, job.shards);
+    auto shardResult = ao::bakeShard(*sceneResult.value, job, options.shard, options.job, options.threads);
+    if (!shardResult) {
+        logging::error("Could not bake shard {}: {}", options.shard, shardResult.error.c_str());
+        return EXIT_FAILURE;
+    }
+    logging::info("Baked {} texels, {} rays per texel on average", shardResult.value->texels, shardResult.value->raysPerTexel());
+    return EXIT_SUCCESS;
+}
+
+int mergeShards(const Options& options) {
+    auto jobResult = ao::ShardJob::Load(options.job);
+    if (!jobResult) {
+        logging::error("Could not load job {}: {}", options.job.c_str(), jobResult.error.c_str());
+        return EXIT_FAILURE;
+    }
+    const auto& job = *jobResult.value;
+
+    logging::info("Loading {}", job.model.c_str());
+    auto modelLoadResult = models::Model::Load(job.model);
+    if (!modelLoadResult) {
+        logging::error("Could not load model {}: {}", job.model.c_str(), modelLoadResult.error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    // The shards are checked against the scene, and filtered with the coverage of its atlas
+    auto sceneResult = ao::BakeScene::Create(*modelLoadResult.value, 0, job.options);
+    if (!sceneResult) {
+        logging::error("Could not set up the scene of model {}: {}", job.model.c_str(), sceneResult.error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    logging::info("Merging {} shards", job.shards);
+    auto mergeResult = ao::mergeShards(*sceneResult.value, job, options.job);
+    if (!mergeResult) {
+        logging::error("Could not merge the shards of {}: {}", options.job.c_str(), mergeResult.error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    // The shards are filtered as a whole, with the rasterization and gutter of the job, like a single bake
+    auto mergeOptions = options;
+    mergeOptions.conservative = job.options.conservative;
+    mergeOptions.gutter = job.options.gutter;
+    auto coverageResult = createCoverage(mergeOptions, *sceneResult.value, job.mapSize);
+    if (!coverageResult) {
+        logging::error("Could not rasterize the atlas of model {}: {}", job.model.c_str(), coverageResult.error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    return writeResults(mergeOptions, *modelLoadResult.value, mergeResult.value, *coverageResult.value);
+}
+
 int main(int argc, char** argv) {
     auto options = parseOpts(argc, argv);
     if (options.verbose) {
         logging::setLevel(logging::Level::DEBUG);
     }
 
-    if (options.outputTexture.empty() && options.output.empty() && options.outputDump.empty()) {
+    if (!options.job.empty() && options.shard >= 0) {
+        return bakeShard(options);
+    }
+
+    if (options.outputTexture.empty() && options.output.empty() && options.outputDump.empty() && options.shards == 0) {
         logging::warn("No output specified");
     }
 
+    if (!options.job.empty() && options.merge) {
+        return mergeShards(options);
+    }
+
     // Load input model
     logging::info("Loading {}", options.input.c_str());
     auto modelLoadResult = models::Model::Load(options.input);
@@ -110,8 +415,54 @@ int main(int argc, char** argv) {
 
     // Take the first scene to create the AO map for
     // TODO: make scene selection an option
-    // TODO: account for transforms
-    auto meshes = modelLoadResult.value->meshes(0, false);
+    // Instanced meshes are only atlased and baked once
+    std::vector<std::shared_ptr<models::Mesh>> meshes;
+    std::set<const models::Mesh*> seen;
+    for (const auto& mesh : modelLoadResult.value->meshes(0, false)) {
+        if (seen.insert(mesh.get()).second) {
+            meshes.push_back(mesh);
+        }
+    }
+
+    const auto sceneOptions = bakeOptions(options);
+
+    if (options.vertex) {
+        // Bake AO into the vertex colors of the model's meshes
+        logging::info("Baking vertex AO");
+        auto sceneResult = ao::BakeScene::Create(*modelLoadResult.value, 0, sceneOptions);
+        if (!sceneResult) {
+            logging::error("Could not set up the scene of model {}: {}", options.input.c_str(), sceneResult.error.c_str());
+            return EXIT_FAILURE;
+        }
+
+        auto bakeResult = ao::bakeVertices(*sceneResult.value, bakeOptions(options));
+        if (!bakeResult) {
+            logging::error("Could not bake vertex AO for model {}: {}", options.input.c_str(), bakeResult.error.c_str());
+            return EXIT_FAILURE;
+        }
+        logging::info("Baked {} vertex sample points, {} rays per point on average",
+                      bakeResult.value->texels,
+                      bakeResult.value->raysPerTexel());
+
+        if (!options.outputTexture.empty()) {
+            logging::warn("No texture is written for vertex bakes");
+        }
+
+        // The vertex colors replace any occlusion texture
+        removeAmbientOcclusionTextures(*modelLoadResult.value);
+
+        if (!options.outputDump.empty()) {
+            logging::info("Writing dump to {}", options.outputDump.c_str());
+            modelLoadResult.value->write(options.outputDump);
+        }
+
+        if (!options.output.empty()) {
+            logging::info("Writing result to {}", options.output.c_str());
+            modelLoadResult.value->write(options.output);
+        }
+
+        return EXIT_SUCCESS;
+    }
 
     auto resolution = options.resolution > 0 ? Size<uint32_t>{options.resolution, options.resolution} : Size<uint32_t>{};
     {
@@ -144,66 +495,85 @@ int main(int argc, char** argv) {
         atlasResult.value->apply(meshes);
     }
 
+    if (options.shards > 0) {
+        if (options.job.empty()) {
+            logging::error("Sharded bakes need a job file");
+            return EXIT_FAILURE;
+        }
+
+        // Every shard bakes the same atlased model
+        ao::ShardJob job{
+                .model = options.job.parent_path() / (options.job.stem().string() + ".glb"),
+                .mapSize = resolution,
+                .shards = options.shards,
+                .options = bakeOptions(options),
+        };
+        logging::info("Writing atlased model to {}", job.model.c_str());
+        modelLoadResult.value->write(job.model);
+        logging::info("Writing job with {} shards to {}", job.shards, options.job.c_str());
+        job.save(options.job);
+        return EXIT_SUCCESS;
+    }
+
     // Bake AO
     logging::info("Baking AO. Resolution {}x{}", resolution.width, resolution.height);
-    auto bakeResult = ao::bake(meshes, resolution, {});
-    if (!bakeResult) {
-        logging::error("Could not bake AO for model {}: {}", options.input.c_str(), bakeResult.error.c_str());
+    auto sceneResult = ao::BakeScene::Create(*modelLoadResult.value, 0, sceneOptions);
+    if (!sceneResult) {
+        logging::error("Could not set up the scene of model {}: {}", options.input.c_str(), sceneResult.error.c_str());
         return EXIT_FAILURE;
     }
 
-    // Blur texture
-    if (options.blurKernelSize > 0) {
-        logging::info("Blur pass. Kernel size {}", options.blurKernelSize);
-        bakeResult.value->blur(options.blurKernelSize);
-    }
-
-    // Debug output
-
-    if (!options.outputDump.empty()) {
-        logging::info("Writing dump to {}", options.outputDump.c_str());
-        modelLoadResult.value->write(options.outputDump);
-    }
+    if (options.tiled) {
+        // The map is streamed to the texture file, it is never in memory as a whole
+        if (options.outputTexture.empty()) {
+            logging::error("Tiled bakes need an output texture file");
+            return EXIT_FAILURE;
+        }
+        if (!options.output.empty() || !options.outputDump.empty()) {
+            logging::warn("Tiled bakes only write the texture, not the model");
+        }
+        if (options.ktx2) {
+            logging::error("Tiled bakes can only write PNG textures");
+            return EXIT_FAILURE;
+        }
 
-    if (!options.outputTexture.empty()) {
         logging::info("Writing texture to {}", options.outputTexture.c_str());
-        auto png = bakeResult.value->png();
-        file::writeFile(options.outputTexture, png.data(), true);
+        auto tiledResult = ao::bakeTiled(*sceneResult.value,
+                                         resolution,
+                                         options.outputTexture,
+                                         bakeOptions(options),
+                                         {
+                                                 .memoryBudget = options.memoryBudget * 1024 * 1024,
+                                                 .denoise = options.denoise,
+                                                 .blurKernelSize = options.blurKernelSize,
+                                         });
+        if (!tiledResult) {
+            logging::error("Could not bake AO for model {}: {}", options.input.c_str(), tiledResult.error.c_str());
+            return EXIT_FAILURE;
+        }
+        logging::info("Baked {} texels, {} rays per texel on average", tiledResult.value->texels, tiledResult.value->raysPerTexel());
+        return EXIT_SUCCESS;
     }
 
-    { // Update the model with the AO Map
-
-        // Remove any occlusion textures from the original
-        removeAmbientOcclusionTextures(*modelLoadResult.value);
-
-        // Ensure all meshes have a material
-        modelLoadResult.value->visit([&](models::Mesh& mesh) {
-            if (mesh.materialIdx() < 0) {
-                mesh.materialIdx(modelLoadResult.value->materials().size());
-                modelLoadResult.value->materials().emplace_back();
-            }
-        });
-
-        // Set the new occlusion texture
-        // TODO: make sure the mesh is actually mapped
-        auto aoTextureIndex = modelLoadResult.value->textures().size();
-        auto aoImageIndex = modelLoadResult.value->images().size();
-        auto aoSamplerIndex = modelLoadResult.value->samplers().size();
-        // TODO: Get rid of magic numbers
-        modelLoadResult.value->samplers().push_back(models::Sampler{.minFilter = 9987, .magFilter = 9729});
-        modelLoadResult.value->images().push_back(bakeResult.value);
-        modelLoadResult.value->textures().push_back(
-                models::Texture{.sampler = static_cast<int>(aoSamplerIndex), .source = static_cast<int>(aoImageIndex)});
-        for (auto& material : modelLoadResult.value->materials()) {
-            material.occlusionTexture = aoTextureIndex;
-        }
+    auto coverageResult = createCoverage(options, *sceneResult.value, resolution);
+    if (!coverageResult) {
+        logging::error("Could not rasterize the atlas of model {}: {}", options.input.c_str(), coverageResult.error.c_str());
+        return EXIT_FAILURE;
     }
 
-    // Output
-    if (!options.output.empty()) {
-        logging::info("Writing result to {}", options.output.c_str());
-        modelLoadResult.value->write(options.output);
+    auto mapOptions = bakeOptions(options);
+    mapOptions.checkpoint = options.checkpoint;
+    mapOptions.resume = options.resume;
+    // Filled after the blur
+    mapOptions.gutter = 0;
+
+    ao::BakeStats bakeStats{};
+    auto bakeResult = ao::bake(*sceneResult.value, *coverageResult.value, mapOptions, &bakeStats);
+    if (!bakeResult) {
+        logging::error("Could not bake AO for model {}: {}", options.input.c_str(), bakeResult.error.c_str());
+        return EXIT_FAILURE;
     }
+    logging::info("Baked {} texels, {} rays per texel on average", bakeStats.texels, bakeStats.raysPerTexel());
 
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+    return writeResults(options, *modelLoadResult.value, bakeResult.value, *coverageResult.value);
+}
@@ -1,22 +1,160 @@
 #pragma once
 
+#include <meshtools/ao/bake_scene.hpp>
 #include <meshtools/image.hpp>
 #include <meshtools/models/model.hpp>
 #include <meshtools/result.hpp>
 #include <meshtools/size.hpp>
 
+#include <filesystem>
 #include <memory>
 #include <vector>
 
 namespace meshtools::ao {
 
+class Coverage;
+
+// How the hemisphere of a texel is sampled
+enum class Sampler {
+    // A single set of uniform random directions, shared by all texels
+    RANDOM,
+    // Low-discrepancy sequences, cosine-weighted around the normal and rotated per texel
+    HALTON,
+    SOBOL,
+};
+
+// Quality of the scene's BVH. Higher quality BVHs take longer to build, but are faster to trace.
+enum class BuildQuality {
+    LOW,
+    MEDIUM,
+    HIGH,
+};
+
+// A rectangle of texels of the map
+struct Region {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    bool empty() const {
+        return width == 0 || height == 0;
+    }
+};
+
 struct BakeOptions {
     int nsamples = 128;
     float multiply = 1.0;
     float maxFar = 5.0;
     uint8_t channels = 1;
+    // Number of bake threads, 0 uses all hardware threads. The result does not depend on the thread count.
+    size_t threads = 0;
+    // Number of texels whose rays are gathered into a single ray stream. Larger streams amortize the per call
+    // overhead and give embree more coherent rays to work with, at the cost of some memory per thread.
+    size_t streamSize = 64;
+
+    // Adaptive sampling: trace texels in batches and stop as soon as the 95% confidence interval of the AO value
+    // is within +/- tolerance. Every texel gets at least minSamples and at most nsamples rays.
+    bool adaptive = false;
+    int minSamples = 16;
+    int batchSamples = 16;
+    float tolerance = 0.02;
+
+    // Bake every texel that a triangle touches, instead of the ones whose center it covers (see Coverage)
+    bool conservative = false;
+
+    // Texels up to this far outside of the atlas charts get the value of the nearest chart texel, so that texture
+    // filtering and mip maps don't pull in the background. Region bakes only fill from texels inside the region.
+    uint32_t gutter = 0;
+
+    // Only bake this part of the map; the resulting image has the size of the region. Texels get the same values as
+    // in a bake of the whole map. An empty region bakes the whole map.
+    Region region{};
+
+    // The low-discrepancy samplers converge a lot faster, so they need far fewer samples for the same noise level
+    Sampler sampler = Sampler::RANDOM;
+
+    // Vertex bakes: ray origins are moved off the surface along the normal by vertexOffset. With averageTriangles,
+    // a vertex is traced from a point inside each of its triangles instead, and the results are averaged. That
+    // avoids artifacts at creases, at the cost of a few times more rays.
+    float vertexOffset = 0.01;
+    bool averageTriangles = false;
+
+    // Scene setup. Compact scenes use less memory for the BVH at the cost of some trace speed, which helps with huge
+    // inputs. Robust scenes avoid missed hits at shared edges and vertices, and are slower as well.
+    BuildQuality buildQuality = BuildQuality::MEDIUM;
+    bool compactScene = false;
+    bool robustScene = false;
+
+    // Map bakes save the finished texels to the checkpoint file every checkpointInterval seconds. With resume, a
+    // checkpoint of the same inputs and options is picked up and its texels are skipped. The checkpoint is removed
+    // once the bake is done. Not used by tiled bakes.
+    std::filesystem::path checkpoint;
+    bool resume = false;
+    double checkpointInterval = 60;
+};
+
+// The filters that run on a baked map, in this order: denoise, blur and gutter fill
+struct FilterOptions {
+    // Edge-avoiding denoise passes (see Image::denoise), 0 disables the denoise
+    uint32_t denoise = 0;
+    // Blur kernel size, 0 disables the blur
+    uint8_t blurKernelSize = 5;
+    // See BakeOptions::gutter
+    uint32_t gutter = 0;
+    size_t threads = 0;
+
+    // Rows (or columns) that the filters read around a texel
+    uint32_t reach() const;
 };
 
-Result<Image> bake(const std::vector<std::shared_ptr<models::Mesh>>& input, const Size<uint32_t>& mapSize, const BakeOptions& options = {});
+struct TiledBakeOptions {
+    // Memory for a band of the map: its coverage, image and filter buffers, for the band and the extra rows around it.
+    // The scene and the per thread buffers come on top.
+    size_t memoryBudget = size_t{256} * 1024 * 1024;
+    // Bands are baked with as many extra rows on both sides as the filters reach, so they cross band borders and the
+    // map matches a single bake. The denoise is the exception: it scales its plane falloff by the average texel size
+    // of the band, and charts that only connect outside of a band and its extra rows are separate charts there.
+    uint32_t denoise = 0;
+    uint8_t blurKernelSize = 5;
+    // Write every band to its own file (<stem>.<band index><extension>) instead of a single PNG
+    bool separateFiles = false;
+};
+
+struct BakeStats {
+    // Texels, or sample points for vertex bakes
+    size_t texels = 0;
+    size_t rays = 0;
+
+    double raysPerTexel() const {
+        return texels > 0 ? (double) rays / (double) texels : 0.0;
+    }
+};
+
+Result<Image> bake(const std::vector<std::shared_ptr<models::Mesh>>& input, const Size<uint32_t>& mapSize, const BakeOptions& options = {},
+                   BakeStats* stats = nullptr);
+
+// Bakes with a scene that was set up before, so its BVH can be re-used between bakes
+Result<Image> bake(const BakeScene& scene, const Size<uint32_t>& mapSize, const BakeOptions& options = {}, BakeStats* stats = nullptr);
+
+// Bakes the texels of a coverage that was created before (see Coverage), for its map size and region
+Result<Image> bake(const BakeScene& scene, const Coverage& coverage, const BakeOptions& options = {}, BakeStats* stats = nullptr);
+
+// Bakes AO per vertex and stores it in the COLOR attribute (float RGBA) of the meshes, replacing any existing
+// vertex colors. No UV atlas is needed, which makes this a lot faster than a texture bake. Meshes without normals
+// use the averaged normals of the adjacent triangles.
+Result<BakeStats> bakeVertices(const std::vector<std::shared_ptr<models::Mesh>>& meshes, const BakeOptions& options = {});
+
+Result<BakeStats> bakeVertices(const BakeScene& scene, const BakeOptions& options = {});
+
+// Denoises and blurs the covered texels of a map (or region) of the coverage, so the background doesn't bleed into
+// the charts, and fills the gutter afterwards. Bakes of the map in parts (tiled, sharded) give the same result as a
+// single bake when their texels are baked without a gutter and filtered this way.
+void filter(Image& image, const Coverage& coverage, const FilterOptions& options);
+
+// Bakes, filters and writes the map (or options.region) to PNG in bands of rows, so maps that don't fit into memory
+// can be baked. Memory use is bounded by the tiled options' memory budget.
+Result<BakeStats> bakeTiled(const BakeScene& scene, const Size<uint32_t>& mapSize, const std::filesystem::path& output,
+                            const BakeOptions& options = {}, const TiledBakeOptions& tiledOptions = {});
 
 } // namespace meshtools::ao
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <meshtools/math.hpp>
+#include <meshtools/models/mesh.hpp>
+#include <meshtools/models/model.hpp>
+#include <meshtools/result.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace meshtools::ao {
+
+struct BakeOptions;
+
+// The committed ray tracing scene (and BVH) for a set of meshes. Building it is a large part of a bake for big
+// models, so a scene can be created once and passed to any number of bakes, for instance at different
+// resolutions or sample counts.
+//
+// The scene keeps references to the meshes, and uses their position and index buffers in place where the layout allows it;
+// their geometry should not be modified while the scene is in use.
+class BakeScene {
+public:
+    BakeScene();
+    ~BakeScene();
+
+    static Result<BakeScene> Create(const std::vector<std::shared_ptr<models::Mesh>>& meshes, const BakeOptions& options);
+
+    static Result<BakeScene> Create(const std::vector<std::shared_ptr<models::Mesh>>& meshes);
+
+    // Sets up a scene of a model with one BVH per mesh group, which is instanced for every node that references it. Meshes
+    // that are instanced more than once share their texture space, so they are baked (once) at their first instance.
+    static Result<BakeScene> Create(const models::Model& model, size_t scene, const BakeOptions& options);
+
+    static Result<BakeScene> Create(const models::Model& model, size_t scene = 0);
+
+    // The meshes that are baked
+    const std::vector<std::shared_ptr<models::Mesh>>& meshes() const;
+
+    // World transforms of the baked meshes
+    const std::vector<glm::mat4>& transforms() const;
+
+    // Every instance of a mesh group in the scene of a model, including the ones that only occlude. Empty for scenes
+    // of meshes.
+    const std::vector<models::Instance>& instances() const;
+
+    // Internal
+    class Impl;
+    const Impl& impl() const {
+        return *impl_;
+    }
+
+private:
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace meshtools::ao
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <meshtools/ao/ao.hpp>
+#include <meshtools/ao/bake_scene.hpp>
+#include <meshtools/image.hpp>
+#include <meshtools/math.hpp>
+#include <meshtools/result.hpp>
+#include <meshtools/size.hpp>
+
+#include <filesystem>
+#include <vector>
+
+namespace meshtools::ao {
+
+// A texel of the map that is covered by an atlased triangle, and the surface point it is traced from
+struct CoverageTexel {
+    uint32_t x;
+    uint32_t y;
+    uint32_t mesh;
+    // Index of the triangle's first vertex index
+    uint32_t triangle;
+    glm::vec3 barycentric;
+    // In world space
+    glm::vec3 position;
+    glm::vec3 normal;
+};
+
+// The covered texels of a map (or a region of it). Rasterizing the atlas is the same for every bake of a scene at a
+// map size, so it can be done once and shared by any number of bakes, for instance at different sample counts.
+// Every texel is listed once, with the last triangle that covers it in (mesh, triangle) order, so no texel is traced
+// twice.
+//
+// Texels are ordered by tiles of the region, and by rows within a tile.
+class Coverage {
+public:
+    // Texels are covered by a triangle when their center is inside of it. With conservative, texels that the triangle
+    // touches at all are covered, which also catches slivers that miss every texel center.
+    static Result<Coverage> Create(const BakeScene& scene, const Size<uint32_t>& mapSize, Region region = {}, size_t threads = 0,
+                                   bool conservative = false);
+
+    // Coverage files hold a hash of the scene's meshes and texture coordinates, and are rejected for other scenes, for
+    // other versions of the format and when they are damaged. The map size and conservative flag are the ones of the
+    // file, callers check that they are the ones they need.
+    static Result<Coverage> Load(const std::filesystem::path& file, const BakeScene& scene);
+
+    // The scene that the coverage was created for
+    void save(const std::filesystem::path& file, const BakeScene& scene) const;
+
+    const Size<uint32_t>& mapSize() const {
+        return mapSize_;
+    }
+
+    const Region& region() const {
+        return region_;
+    }
+
+    bool conservative() const {
+        return conservative_;
+    }
+
+    const std::vector<CoverageTexel>& texels() const {
+        return texels_;
+    }
+
+    // Single channel image of the region with 255 for covered texels and 0 elsewhere
+    Image mask() const;
+
+    // Guides of the region for Image::denoise. Charts are the connected areas of covered texels, which the atlas
+    // keeps apart.
+    DenoiseGuides guides() const;
+
+private:
+    Size<uint32_t> mapSize_{};
+    Region region_{};
+    bool conservative_ = false;
+    std::vector<CoverageTexel> texels_;
+};
+
+} // namespace meshtools::ao
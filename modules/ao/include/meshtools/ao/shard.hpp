@@ -0,0 +1,46 @@
+#pragma once
+
+#include <meshtools/ao/ao.hpp>
+#include <meshtools/ao/bake_scene.hpp>
+#include <meshtools/image.hpp>
+#include <meshtools/result.hpp>
+#include <meshtools/size.hpp>
+
+#include <filesystem>
+
+namespace meshtools::ao {
+
+// A bake that is split into shards (bands of rows of the map), which separate processes or machines bake
+// independently. All shards bake the same atlased model with the same options and sample sequences, and a region
+// bake produces the same texels as a full bake, so the merged map is identical to a single bake.
+//
+// Jobs are plain text files with one "key value" pair per line.
+struct ShardJob {
+    // The atlased model; relative to the job file when loaded
+    std::filesystem::path model;
+    Size<uint32_t> mapSize{};
+    uint32_t shards = 1;
+    // Only the options that affect the baked values are stored, including the scene setup. Shards are baked with a
+    // scene that is set up with these options.
+    BakeOptions options;
+
+    static Result<ShardJob> Load(const std::filesystem::path& file);
+
+    void save(const std::filesystem::path& file) const;
+
+    Region region(uint32_t shard) const;
+};
+
+// Shard files are stored next to the job file
+std::filesystem::path shardFile(const std::filesystem::path& jobFile, uint32_t shard);
+
+// Bakes one shard of a job into its shard file
+Result<BakeStats> bakeShard(const BakeScene& scene, const ShardJob& job, uint32_t shard, const std::filesystem::path& jobFile,
+                            size_t threads = 0);
+
+// Assembles the shard files of a job into the map. Like the shards, it has no gutter yet; filtering it (see filter)
+// with the coverage of the whole map and the job's gutter gives the map of a single bake. Shards that were baked for
+// another scene, or another version of the job, are rejected.
+Result<Image> mergeShards(const BakeScene& scene, const ShardJob& job, const std::filesystem::path& jobFile);
+
+} // namespace meshtools::ao
@@ -1,27 +1,184 @@
 #include <meshtools/ao/ao.hpp>
+#include <meshtools/ao/coverage.hpp>
 
+#include <meshtools/logging.hpp>
 #include <meshtools/models/model.hpp>
+#include <meshtools/png_writer.hpp>
 
 #include "rasterize.hpp"
 #include "raytrace.hpp"
+#include "tiled.hpp"
 
 namespace meshtools::ao {
 
+namespace {
+
+std::filesystem::path bandPath(const std::filesystem::path& output, size_t band) {
+    auto path = output;
+    path.replace_filename(output.stem().string() + "." + std::to_string(band) + output.extension().string());
+    return path;
+}
+
+} // namespace
+
 inline RaytraceOptions createOptions(const BakeOptions& options) {
     return {
             .nsamples = options.nsamples,
             .resultChannels = options.channels,
             .far = options.maxFar,
             .multiply = options.multiply,
+            .threads = options.threads,
+            .streamSize = options.streamSize,
+            .adaptive = options.adaptive,
+            .minSamples = options.minSamples,
+            .batchSamples = options.batchSamples,
+            .tolerance = options.tolerance,
+            .sampler = options.sampler,
+            .vertexOffset = options.vertexOffset,
+            .averageTriangles = options.averageTriangles,
+            .region = options.region,
+            .conservative = options.conservative,
+            .gutter = options.gutter,
+            .checkpoint = options.checkpoint,
+            .resume = options.resume,
+            .checkpointInterval = options.checkpointInterval,
     };
 }
 
-Result<Image> bake(const std::vector<std::shared_ptr<models::Mesh>>& meshes, const Size<uint32_t>& mapSize, const BakeOptions& options) {
-    auto raytraceResult = raytrace(meshes, mapSize, createOptions(options));
+Result<Image> bake(const std::vector<std::shared_ptr<models::Mesh>>& meshes, const Size<uint32_t>& mapSize, const BakeOptions& options,
+                   BakeStats* stats) {
+    auto sceneResult = BakeScene::Create(meshes, options);
+    if (!sceneResult) {
+        return {std::move(sceneResult.error)};
+    }
+    return bake(*sceneResult.value, mapSize, options, stats);
+}
+
+Result<Image> bake(const BakeScene& scene, const Size<uint32_t>& mapSize, const BakeOptions& options, BakeStats* stats) {
+    auto raytraceResult = raytrace(scene, mapSize, createOptions(options), stats);
     if (!raytraceResult) {
         return {std::move(raytraceResult.error)};
     }
     return {std::move(raytraceResult.value)};
 }
 
+Result<Image> bake(const BakeScene& scene, const Coverage& coverage, const BakeOptions& options, BakeStats* stats) {
+    return raytrace(scene, coverage, createOptions(options), stats);
+}
+
+Result<BakeStats> bakeVertices(const std::vector<std::shared_ptr<models::Mesh>>& meshes, const BakeOptions& options) {
+    auto sceneResult = BakeScene::Create(meshes, options);
+    if (!sceneResult) {
+        return {std::move(sceneResult.error)};
+    }
+    return bakeVertices(*sceneResult.value, options);
+}
+
+Result<BakeStats> bakeVertices(const BakeScene& scene, const BakeOptions& options) {
+    return raytraceVertices(scene, createOptions(options));
+}
+
+uint32_t FilterOptions::reach() const {
+    // Denoise pass i reads 2 texels of 2^i apart. Passes beyond 16 reach further than any map is large.
+    const uint32_t denoiseReach = 2 * ((1u << std::min<uint32_t>(denoise, 16)) - 1);
+    return denoiseReach + blurKernelSize + gutter;
+}
+
+void filter(Image& image, const Coverage& coverage, const FilterOptions& options) {
+    if (options.denoise > 0) {
+        image.denoise(coverage.guides(), {.iterations = options.denoise, .threads = options.threads});
+    }
+
+    if (options.blurKernelSize == 0 && options.gutter == 0) {
+        return;
+    }
+
+    const auto mask = coverage.mask();
+    if (options.blurKernelSize > 0) {
+        image.blur(mask, options.blurKernelSize, options.threads);
+    }
+    if (options.gutter > 0) {
+        image.dilate(mask, options.gutter, options.threads);
+    }
+}
+
+Result<BakeStats> bakeTiled(const BakeScene& scene, const Size<uint32_t>& mapSize, const std::filesystem::path& output,
+                            const BakeOptions& options, const TiledBakeOptions& tiledOptions) {
+    const Region area = options.region.empty() ? Region{0, 0, mapSize.width, mapSize.height} : options.region;
+    const size_t rowBytes = static_cast<size_t>(area.width) * options.channels;
+    const FilterOptions filterOptions{
+            .denoise = tiledOptions.denoise,
+            .blurKernelSize = tiledOptions.blurKernelSize,
+            .gutter = options.gutter,
+            .threads = options.threads,
+    };
+    const uint32_t halo = filterOptions.reach();
+
+    const auto bandHeight = ao::bandHeight(tiledOptions.memoryBudget, area.width, area.height, options.channels, filterOptions);
+    if (bandHeight == 0) {
+        return {"Memory budget too small for a single row of the map"};
+    }
+    const auto bands = (area.height + bandHeight - 1) / bandHeight;
+    logging::debug("Tiled bake - {} bands of {} rows", bands, bandHeight);
+
+    std::shared_ptr<PngWriter> writer;
+    if (!tiledOptions.separateFiles) {
+        auto writerResult = PngWriter::Open(output, area.width, area.height, options.channels);
+        if (!writerResult) {
+            return {std::move(writerResult.error)};
+        }
+        writer = writerResult.value;
+    }
+
+    BakeStats totals{};
+    for (uint32_t band = 0; band < bands; band++) {
+        const auto y = band * bandHeight;
+        const auto rows = std::min(bandHeight, area.height - y);
+        const auto top = std::min(y, halo);
+        const auto bottom = std::min(halo, area.height - y - rows);
+
+        const Region bandRegion{area.x, area.y + y - top, area.width, rows + top + bottom};
+        auto coverageResult = Coverage::Create(scene, mapSize, bandRegion, options.threads, options.conservative);
+        if (!coverageResult) {
+            return {std::move(coverageResult.error)};
+        }
+
+        // The gutter is filled after the other filters
+        auto bandOptions = createOptions(options);
+        bandOptions.gutter = 0;
+        bandOptions.checkpoint.clear();
+        BakeStats bandStats{};
+        auto bandResult = raytrace(scene, *coverageResult.value, bandOptions, &bandStats);
+        if (!bandResult) {
+            return {std::move(bandResult.error)};
+        }
+        totals.texels += bandStats.texels;
+        totals.rays += bandStats.rays;
+
+        filter(*bandResult.value, *coverageResult.value, filterOptions);
+
+        const auto* data = bandResult.value->data().data() + top * rowBytes;
+        if (tiledOptions.separateFiles) {
+            auto path = bandPath(output, band);
+            auto writerResult = PngWriter::Open(path, area.width, rows, options.channels);
+            if (!writerResult) {
+                return {std::move(writerResult.error)};
+            }
+            writerResult.value->write(data, rows, options.threads);
+            if (!writerResult.value->finish()) {
+                return {"Could not write " + path.string()};
+            }
+        } else {
+            writer->write(data, rows, options.threads);
+        }
+        logging::debug("Tiled bake - band {} of {} done", band + 1, bands);
+    }
+
+    if (writer && !writer->finish()) {
+        return {"Could not write " + output.string()};
+    }
+
+    return Result<BakeStats>{std::make_shared<BakeStats>(totals)};
+}
+
 } // namespace meshtools::ao
@@ -0,0 +1,266 @@
+#include <meshtools/ao/ao.hpp>
+#include <meshtools/ao/bake_scene.hpp>
+
+#include <meshtools/logging.hpp>
+#include <meshtools/math.hpp>
+
+#include "bake_scene_impl.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <optional>
+
+namespace meshtools::ao {
+
+namespace {
+
+bool hasPositions(const std::vector<std::shared_ptr<models::Mesh>>& meshes) {
+    return std::all_of(meshes.begin(), meshes.end(), [](const std::shared_ptr<models::Mesh>& mesh) {
+        return mesh->hasVertexAttribute(models::AttributeType::POSITION);
+    });
+}
+
+// Embree reads buffers with 16 byte loads, which may run past the last element
+const constexpr size_t EMBREE_TAIL_PADDING = 16;
+
+// Whether embree can use the data in place: the layout has to match, and the end of the buffer has to be padded
+bool shareable(const models::TypedData& data, models::DataType dataType, size_t componentCount) {
+    const auto& buffer = data.buffer();
+    return data.dataType() == dataType && data.componentCount() == componentCount && !buffer.empty() &&
+           reinterpret_cast<uintptr_t>(buffer.data()) % sizeof(float) == 0 && buffer.capacity() >= buffer.size() + EMBREE_TAIL_PADDING;
+}
+
+// Sets a geometry buffer, sharing the mesh data when possible and copying (and converting) it otherwise
+template<class T>
+void setBuffer(RTCGeometry geometry, RTCBufferType type, RTCFormat format, const models::TypedData& data, models::DataType dataType,
+               size_t componentCount, size_t itemStride, size_t itemCount, BakeScene::Impl& impl) {
+    if (shareable(data, dataType, componentCount)) {
+        rtcSetSharedGeometryBuffer(geometry, type, 0, format, data.buffer().data(), 0, itemStride, itemCount);
+        impl.sharedBytes += itemStride * itemCount;
+        return;
+    }
+
+    models::DataView<T> view{data};
+    auto* buffer = rtcSetNewGeometryBuffer(geometry, type, 0, format, itemStride, itemCount);
+    assert(buffer);
+    view.copyTo(buffer);
+    impl.copiedBytes += itemStride * itemCount;
+}
+
+void attachMesh(BakeScene::Impl& impl, RTCScene scene, const models::Mesh& mesh) {
+    // Populate the embree mesh.
+    // TODO: Backface culling
+    auto* geometry = impl.newTriangleGeometry();
+
+    const auto& positions = mesh.vertexAttribute(models::AttributeType::POSITION);
+    setBuffer<glm::vec3>(geometry,
+                         RTC_BUFFER_TYPE_VERTEX,
+                         RTC_FORMAT_FLOAT3,
+                         positions,
+                         models::DataType::FLOAT,
+                         3,
+                         sizeof(glm::vec3),
+                         positions.size(),
+                         impl);
+
+    // Triangles are three consecutive indices
+    const auto& indices = mesh.indices();
+    setBuffer<uint32_t>(geometry,
+                        RTC_BUFFER_TYPE_INDEX,
+                        RTC_FORMAT_UINT3,
+                        indices,
+                        models::DataType::U_INT,
+                        1,
+                        3 * sizeof(uint32_t),
+                        indices.size() / 3,
+                        impl);
+
+    rtcCommitGeometry(geometry);
+    rtcAttachGeometry(scene, geometry);
+    rtcReleaseGeometry(geometry);
+}
+
+void logBuild(const BakeScene::Impl& impl) {
+    logging::debug("Bake scene - shared {} bytes of mesh data, copied {} bytes", impl.sharedBytes, impl.copiedBytes);
+    logging::debug("Bake scene - built in {:.3f}s (quality {}, flags {}), using {} MB (peak {} MB)",
+                   impl.buildSeconds,
+                   static_cast<int>(impl.buildQuality),
+                   static_cast<int>(impl.sceneFlags),
+                   impl.memory / (1024 * 1024),
+                   impl.peakMemory / (1024 * 1024));
+}
+
+bool monitorMemory(void* ptr, ssize_t bytes, bool /*post*/) {
+    auto& impl = *static_cast<BakeScene::Impl*>(ptr);
+    auto memory = impl.memory += bytes;
+    auto peak = impl.peakMemory.load();
+    while (memory > peak && !impl.peakMemory.compare_exchange_weak(peak, memory)) {
+    }
+    return true;
+}
+
+RTCBuildQuality toBuildQuality(BuildQuality quality) {
+    switch (quality) {
+        case BuildQuality::LOW:
+            return RTC_BUILD_QUALITY_LOW;
+        case BuildQuality::MEDIUM:
+            return RTC_BUILD_QUALITY_MEDIUM;
+        case BuildQuality::HIGH:
+            return RTC_BUILD_QUALITY_HIGH;
+    }
+    return RTC_BUILD_QUALITY_MEDIUM;
+}
+
+} // namespace
+
+BakeScene::Impl::Impl() {
+    // Create the embree device and scene.
+    device = rtcNewDevice(nullptr);
+    assert(device && "Unable to create embree device.");
+    rtcSetDeviceMemoryMonitorFunction(device, monitorMemory, this);
+    scene = rtcNewScene(device);
+    assert(scene);
+}
+
+void BakeScene::Impl::configure(const BakeOptions& options) {
+    buildQuality = toBuildQuality(options.buildQuality);
+    sceneFlags = RTC_SCENE_FLAG_NONE;
+    if (options.compactScene) {
+        sceneFlags = sceneFlags | RTC_SCENE_FLAG_COMPACT;
+    }
+    if (options.robustScene) {
+        sceneFlags = sceneFlags | RTC_SCENE_FLAG_ROBUST;
+    }
+
+    rtcSetSceneBuildQuality(scene, buildQuality);
+    rtcSetSceneFlags(scene, sceneFlags);
+}
+
+RTCScene BakeScene::Impl::newScene() {
+    auto* newScene = rtcNewScene(device);
+    assert(newScene);
+    rtcSetSceneBuildQuality(newScene, buildQuality);
+    rtcSetSceneFlags(newScene, sceneFlags);
+    return newScene;
+}
+
+RTCGeometry BakeScene::Impl::newTriangleGeometry() {
+    auto* geometry = rtcNewGeometry(device, RTC_GEOMETRY_TYPE_TRIANGLE);
+    assert(geometry);
+    // High quality builds of triangle geometry use spatial splits
+    rtcSetGeometryBuildQuality(geometry, buildQuality);
+    return geometry;
+}
+
+void BakeScene::Impl::commit(RTCScene sceneToCommit) {
+    auto start = std::chrono::steady_clock::now();
+    rtcCommitScene(sceneToCommit);
+    buildSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+BakeScene::Impl::~Impl() {
+    // Free all embree data.
+    rtcReleaseScene(scene);
+    for (auto* instancedScene : instancedScenes) {
+        rtcReleaseScene(instancedScene);
+    }
+    rtcReleaseDevice(device);
+}
+
+BakeScene::BakeScene() : impl_(std::make_unique<BakeScene::Impl>()) {}
+
+BakeScene::~BakeScene() = default;
+
+Result<BakeScene> BakeScene::Create(const std::vector<std::shared_ptr<models::Mesh>>& meshes) {
+    return Create(meshes, {});
+}
+
+Result<BakeScene> BakeScene::Create(const std::vector<std::shared_ptr<models::Mesh>>& meshes, const BakeOptions& options) {
+    if (!hasPositions(meshes)) {
+        return {"Cannot create a bake scene for meshes without positions"};
+    }
+
+    logging::debug("Bake scene - setting up scene");
+
+    Result<BakeScene> result{std::make_shared<BakeScene>()};
+    auto& impl = *result.value->impl_;
+    impl.configure(options);
+    impl.meshes = meshes;
+    impl.transforms.assign(meshes.size(), glm::mat4{1});
+
+    for (const auto& mesh : meshes) {
+        attachMesh(impl, impl.scene, *mesh);
+    }
+
+    impl.commit(impl.scene);
+    logBuild(impl);
+
+    return result;
+}
+
+Result<BakeScene> BakeScene::Create(const models::Model& model, size_t scene) {
+    return Create(model, scene, {});
+}
+
+Result<BakeScene> BakeScene::Create(const models::Model& model, size_t scene, const BakeOptions& options) {
+    const auto& meshGroups = model.meshGroups();
+    auto instances = model.instances(scene);
+
+    logging::debug("Bake scene - setting up {} instances of {} mesh groups", instances.size(), meshGroups.size());
+
+    Result<BakeScene> result{std::make_shared<BakeScene>()};
+    auto& impl = *result.value->impl_;
+    impl.configure(options);
+    impl.instances = instances;
+
+    // One scene per referenced mesh group, set up on first use
+    std::vector<std::optional<RTCScene>> groupScenes(meshGroups.size());
+    for (const auto& instance : instances) {
+        assert(instance.meshGroup < meshGroups.size());
+        auto& groupScene = groupScenes[instance.meshGroup];
+        if (!groupScene) {
+            const auto& meshes = meshGroups[instance.meshGroup].meshes();
+            if (!hasPositions(meshes)) {
+                return {"Cannot create a bake scene for meshes without positions"};
+            }
+
+            groupScene = impl.newScene();
+            impl.instancedScenes.push_back(*groupScene);
+            for (const auto& mesh : meshes) {
+                attachMesh(impl, *groupScene, *mesh);
+                impl.meshes.push_back(mesh);
+                impl.transforms.push_back(instance.transform);
+            }
+            impl.commit(*groupScene);
+        }
+
+        auto* geometry = rtcNewGeometry(impl.device, RTC_GEOMETRY_TYPE_INSTANCE);
+        assert(geometry);
+        rtcSetGeometryInstancedScene(geometry, *groupScene);
+        rtcSetGeometryTransform(geometry, 0, RTC_FORMAT_FLOAT4X4_COLUMN_MAJOR, &instance.transform[0][0]);
+        rtcCommitGeometry(geometry);
+        rtcAttachGeometry(impl.scene, geometry);
+        rtcReleaseGeometry(geometry);
+    }
+
+    impl.commit(impl.scene);
+    logBuild(impl);
+
+    logging::debug("Bake scene - {} mesh group scenes, {} meshes to bake", impl.instancedScenes.size(), impl.meshes.size());
+
+    return result;
+}
+
+const std::vector<std::shared_ptr<models::Mesh>>& BakeScene::meshes() const {
+    return impl_->meshes;
+}
+
+const std::vector<glm::mat4>& BakeScene::transforms() const {
+    return impl_->transforms;
+}
+
+const std::vector<models::Instance>& BakeScene::instances() const {
+    return impl_->instances;
+}
+
+} // namespace meshtools::ao
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <meshtools/ao/bake_scene.hpp>
+
+#include <embree3/rtcore.h>
+
+#include <atomic>
+
+namespace meshtools::ao {
+
+class BakeScene::Impl {
+public:
+    Impl();
+    ~Impl();
+
+    // Applies the scene options to the top-level scene, and to the scenes and geometries that are created afterwards
+    void configure(const BakeOptions& options);
+
+    RTCScene newScene();
+    RTCGeometry newTriangleGeometry();
+    // Commits a scene and keeps track of the build time
+    void commit(RTCScene scene);
+
+    RTCDevice device = nullptr;
+    RTCScene scene = nullptr;
+    // Scenes of the instanced mesh groups
+    std::vector<RTCScene> instancedScenes;
+    std::vector<std::shared_ptr<models::Mesh>> meshes;
+    std::vector<glm::mat4> transforms;
+    std::vector<models::Instance> instances;
+
+    // Geometry buffers that embree uses in place, and ones that had to be copied
+    size_t sharedBytes = 0;
+    size_t copiedBytes = 0;
+
+    RTCBuildQuality buildQuality = RTC_BUILD_QUALITY_MEDIUM;
+    RTCSceneFlags sceneFlags = RTC_SCENE_FLAG_NONE;
+
+    // Embree memory usage, reported by the device memory monitor
+    std::atomic<int64_t> memory{0};
+    std::atomic<int64_t> peakMemory{0};
+    double buildSeconds = 0.0;
+};
+
+} // namespace meshtools::ao
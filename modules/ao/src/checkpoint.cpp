@@ -0,0 +1,106 @@
+#include "checkpoint.hpp"
+
+#include "hash.hpp"
+
+#include <meshtools/file.hpp>
+#include <meshtools/logging.hpp>
+
+#include <array>
+#include <cstring>
+#include <fstream>
+
+namespace meshtools::ao {
+
+namespace {
+
+const constexpr std::array<char, 8> CHECKPOINT_MAGIC{'M', 'T', 'A', 'O', 'C', 'K', 'P', '1'};
+
+struct CheckpointHeader {
+    std::array<char, 8> magic;
+    uint64_t hash;
+    uint64_t chunkCount;
+    uint64_t imageSize;
+};
+
+} // namespace
+
+uint64_t checkpointHash(const BakeScene& scene, const Size<uint32_t>& size, const RaytraceOptions& options) {
+    Hasher hasher;
+    hasher.add(scene);
+    hasher.add(size.width);
+    hasher.add(size.height);
+    hasher.add(options.nsamples);
+    hasher.add(options.resultChannels);
+    hasher.add(options.far);
+    hasher.add(options.multiply);
+    hasher.add(options.adaptive);
+    hasher.add(options.minSamples);
+    hasher.add(options.batchSamples);
+    hasher.add(options.tolerance);
+    hasher.add(options.sampler);
+    hasher.add(options.region);
+    hasher.add(options.conservative);
+    hasher.add(options.gutter);
+    return hasher.hash;
+}
+
+void saveCheckpoint(const std::filesystem::path& file, uint64_t hash, const std::vector<uint8_t>& chunks, const Image& image) {
+    const CheckpointHeader header{CHECKPOINT_MAGIC, hash, chunks.size(), image.data().size()};
+
+    // Written next to the checkpoint and moved over it, so a pre-empted write never leaves a broken checkpoint
+    auto temporary = file;
+    temporary += ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        if (!out.is_open()) {
+            logging::error("Cannot write checkpoint {}", temporary.string());
+            return;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(chunks.data()), chunks.size());
+        out.write(reinterpret_cast<const char*>(image.data().data()), image.data().size());
+        if (!out) {
+            logging::error("Cannot write checkpoint {}", temporary.string());
+            out.close();
+            std::error_code error;
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, file, error);
+    if (error) {
+        logging::error("Cannot write checkpoint {}: {}", file.string(), error.message());
+        std::filesystem::remove(temporary, error);
+    }
+}
+
+std::optional<std::vector<uint8_t>> loadCheckpoint(const std::filesystem::path& file, uint64_t hash, size_t chunkCount, Image& image) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in.is_open()) {
+        logging::warn("No checkpoint {} to resume from", file.string());
+        return std::nullopt;
+    }
+
+    CheckpointHeader header{};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != CHECKPOINT_MAGIC || header.hash != hash || header.chunkCount != chunkCount ||
+        header.imageSize != image.data().size()) {
+        logging::warn("Checkpoint {} is from a different bake, starting over", file.string());
+        return std::nullopt;
+    }
+
+    std::vector<uint8_t> chunks(chunkCount);
+    in.read(reinterpret_cast<char*>(chunks.data()), chunks.size());
+    in.read(reinterpret_cast<char*>(image.data().data()), image.data().size());
+    if (!in) {
+        logging::warn("Checkpoint {} is truncated, starting over", file.string());
+        std::fill(image.data().begin(), image.data().end(), 0);
+        return std::nullopt;
+    }
+
+    return chunks;
+}
+
+} // namespace meshtools::ao
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <meshtools/ao/bake_scene.hpp>
+#include <meshtools/image.hpp>
+#include <meshtools/size.hpp>
+
+#include "raytrace.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace meshtools::ao {
+
+// Identifies a bake: hashes the scene's geometry, normals and texture coordinates, the map size and all options
+// that affect the baked values
+uint64_t checkpointHash(const BakeScene& scene, const Size<uint32_t>& size, const RaytraceOptions& options);
+
+// Checkpoints hold the finished chunks of texels (one flag per chunk) and the image with their texels
+void saveCheckpoint(const std::filesystem::path& file, uint64_t hash, const std::vector<uint8_t>& chunks, const Image& image);
+
+// Restores the texels of the finished chunks into the image and returns the chunk flags, if the checkpoint
+// belongs to the same bake
+std::optional<std::vector<uint8_t>> loadCheckpoint(const std::filesystem::path& file, uint64_t hash, size_t chunkCount, Image& image);
+
+} // namespace meshtools::ao
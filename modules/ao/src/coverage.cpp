@@ -0,0 +1,402 @@
+#include <meshtools/ao/coverage.hpp>
+
+#include "hash.hpp"
+#include "rasterize.hpp"
+
+#include <meshtools/file.hpp>
+#include <meshtools/logging.hpp>
+#include <meshtools/parallel.hpp>
+
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace meshtools::ao {
+
+namespace {
+
+// Edge length of the square tiles the atlas is rasterized in
+const constexpr uint32_t TILE_SIZE = 64;
+
+const constexpr std::array<char, 8> COVERAGE_MAGIC{'M', 'T', 'A', 'O', 'C', 'O', 'V', 'R'};
+
+// Bumped whenever the layout of the file or of CoverageTexel changes
+const constexpr uint32_t COVERAGE_VERSION = 2;
+
+struct CoverageHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t conservative;
+    // Of the scene the coverage was created for
+    uint64_t sceneHash;
+    uint32_t mapWidth;
+    uint32_t mapHeight;
+    Region region;
+    uint64_t texelCount;
+};
+
+uint64_t sceneHash(const BakeScene& scene) {
+    Hasher hasher;
+    hasher.add(scene);
+    return hasher.hash;
+}
+
+struct Vertex {
+    Vertex(glm::vec3 pos, glm::vec3 norm, glm::vec2 tex)
+        : position(pos), normal(norm), uv(tex), uv2i({static_cast<int>(tex[0]), static_cast<int>(tex[1])}) {}
+    Vertex() = default;
+
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+    glm::vec<2, int, glm::defaultp> uv2i;
+};
+
+using Triangle = std::array<Vertex, 3>;
+
+// Views are set up once per mesh and shared (read-only) between the workers
+struct MeshViews {
+    MeshViews(const models::Mesh& mesh, const glm::mat4& transform)
+        : indices(mesh.indices<uint32_t>()), positions(mesh.vertexAttribute<glm::vec3>(models::AttributeType::POSITION)),
+          normals(mesh.vertexAttribute<glm::vec3>(models::AttributeType::NORMAL)),
+          texcoords(mesh.vertexAttribute(models::AttributeType::TEXCOORD)), transform(transform),
+          normalTransform(glm::transpose(glm::inverse(glm::mat3{transform}))), identity(transform == glm::mat4{1}) {}
+
+    // Positions and normals in world space
+    glm::vec3 position(uint32_t index) const {
+        return identity ? positions[index] : glm::vec3{transform * glm::vec4{positions[index], 1.0f}};
+    }
+
+    glm::vec3 normal(uint32_t index) const {
+        return identity ? normals[index] : glm::normalize(normalTransform * normals[index]);
+    }
+
+    models::DataView<uint32_t> indices;
+    models::DataView<glm::vec3> positions;
+    models::DataView<glm::vec3> normals;
+    models::NormalizedView<glm::vec2> texcoords;
+    glm::mat4 transform;
+    glm::mat3 normalTransform;
+    bool identity;
+};
+
+struct TriangleRef {
+    uint32_t mesh;
+    uint32_t index;
+};
+
+struct Tile {
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+    // Triangles overlapping the tile, in serial (mesh, index) order
+    std::vector<TriangleRef> triangles;
+};
+
+// Returns false for triangles that weren't atlased
+bool loadTriangle(const MeshViews& views, uint32_t j, float uscale, float vscale, Triangle& triangle) {
+    for (size_t k = 0; k < 3; k++) {
+        auto index = views.indices[j + k];
+        assert(views.texcoords.size() > index);
+        auto uv = views.texcoords[index];
+        uv[0] *= uscale;
+        uv[1] *= vscale;
+        assert(uv[0] <= uscale);
+        assert(uv[1] <= vscale);
+        triangle[k] = {views.position(index), views.normal(index), uv};
+    }
+
+    return triangle[0].uv[0] || triangle[0].uv[1] || triangle[1].uv[0] || triangle[1].uv[1] || triangle[2].uv[0] || triangle[2].uv[1];
+}
+
+// Tiles are laid out from the top left corner of the region, in map coordinates
+std::vector<Tile> binTriangles(const std::vector<MeshViews>& views, const Size<uint32_t>& size, const Region& region) {
+    const float uscale = size.width;
+    const float vscale = size.height;
+    const int tilesX = (region.width + TILE_SIZE - 1) / TILE_SIZE;
+    const int tilesY = (region.height + TILE_SIZE - 1) / TILE_SIZE;
+    const int regionX = region.x;
+    const int regionY = region.y;
+    const int regionMaxX = region.x + region.width - 1;
+    const int regionMaxY = region.y + region.height - 1;
+
+    std::vector<Tile> tiles;
+    tiles.reserve(tilesX * tilesY);
+    for (int ty = 0; ty < tilesY; ty++) {
+        for (int tx = 0; tx < tilesX; tx++) {
+            tiles.push_back({
+                    static_cast<int>(regionX + tx * TILE_SIZE),
+                    static_cast<int>(regionY + ty * TILE_SIZE),
+                    std::min(regionX + (tx + 1) * (int) TILE_SIZE - 1, regionMaxX),
+                    std::min(regionY + (ty + 1) * (int) TILE_SIZE - 1, regionMaxY),
+                    {},
+            });
+        }
+    }
+
+    Triangle tri{};
+    for (uint32_t meshIdx = 0; meshIdx < views.size(); meshIdx++) {
+        auto& meshViews = views[meshIdx];
+        for (uint32_t j = 0; j + 2 < meshViews.indices.size(); j += 3) {
+            if (!loadTriangle(meshViews, j, uscale, vscale, tri)) {
+                continue; // Skip triangles that weren't atlased.
+            }
+
+            auto minX = std::min({tri[0].uv2i[0], tri[1].uv2i[0], tri[2].uv2i[0]});
+            auto maxX = std::max({tri[0].uv2i[0], tri[1].uv2i[0], tri[2].uv2i[0]});
+            auto minY = std::min({tri[0].uv2i[1], tri[1].uv2i[1], tri[2].uv2i[1]});
+            auto maxY = std::max({tri[0].uv2i[1], tri[1].uv2i[1], tri[2].uv2i[1]});
+            if (maxX < regionX || maxY < regionY || minX > regionMaxX || minY > regionMaxY) {
+                continue;
+            }
+
+            auto tx0 = (std::max(regionX, minX) - regionX) / (int) TILE_SIZE;
+            auto tx1 = (std::min(regionMaxX, maxX) - regionX) / (int) TILE_SIZE;
+            auto ty0 = (std::max(regionY, minY) - regionY) / (int) TILE_SIZE;
+            auto ty1 = (std::min(regionMaxY, maxY) - regionY) / (int) TILE_SIZE;
+            for (auto ty = ty0; ty <= ty1; ty++) {
+                for (auto tx = tx0; tx <= tx1; tx++) {
+                    tiles[ty * tilesX + tx].triangles.push_back({meshIdx, j});
+                }
+            }
+        }
+    }
+
+    return tiles;
+}
+
+// Rasterizes the triangles of a tile; a texel keeps the last triangle that covers it
+void rasterizeTile(const std::vector<MeshViews>& views, const Tile& tile, float uscale, float vscale, bool conservative,
+                   std::vector<CoverageTexel>& slots, std::vector<uint8_t>& covered, std::vector<CoverageTexel>& texels) {
+    Triangle triangle{};
+    for (const auto& ref : tile.triangles) {
+        loadTriangle(views[ref.mesh], ref.index, uscale, vscale, triangle);
+
+        RasterizeTriangle(
+                triangle[0].uv, triangle[1].uv, triangle[2].uv, tile.minX, tile.minY, tile.maxX, tile.maxY, conservative, [&](int x, int y, glm::vec3 bc) {
+                    if (conservative) {
+                        // Texel centers outside of the triangle are traced from its closest point
+                        bc = glm::max(bc, glm::vec3{0.0f});
+                        bc /= bc[0] + bc[1] + bc[2];
+                    }
+
+                    // Interpolate normal and origin
+                    auto normal = glm::normalize(triangle[0].normal * bc[0] + triangle[1].normal * bc[1] + triangle[2].normal * bc[2]);
+                    auto position = triangle[0].position * bc[0] + triangle[1].position * bc[1] + triangle[2].position * bc[2];
+
+                    auto slot = (y - tile.minY) * TILE_SIZE + (x - tile.minX);
+                    slots[slot] = {static_cast<uint32_t>(x), static_cast<uint32_t>(y), ref.mesh, ref.index, bc, position, normal};
+                    covered[slot] = 1;
+                });
+    }
+
+    for (int y = tile.minY; y <= tile.maxY; y++) {
+        for (int x = tile.minX; x <= tile.maxX; x++) {
+            auto slot = (y - tile.minY) * TILE_SIZE + (x - tile.minX);
+            if (covered[slot]) {
+                texels.push_back(slots[slot]);
+                covered[slot] = 0;
+            }
+        }
+    }
+}
+
+} // namespace
+
+Result<Coverage> Coverage::Create(const BakeScene& scene, const Size<uint32_t>& mapSize, Region region, size_t threads, bool conservative) {
+    const auto& meshes = scene.meshes();
+    if (std::any_of(meshes.begin(), meshes.end(), [](const std::shared_ptr<models::Mesh>& mesh) {
+            return !mesh->hasVertexAttribute(models::AttributeType::TEXCOORD);
+        })) {
+        return {"Cannot raytrace models without texture coordinates"};
+    }
+
+    if (std::any_of(meshes.begin(), meshes.end(), [](const std::shared_ptr<models::Mesh>& mesh) {
+            return !mesh->hasVertexAttribute(models::AttributeType::NORMAL);
+        })) {
+        return {"Cannot raytrace models without normals"};
+    }
+
+    if (region.empty()) {
+        region = {0, 0, mapSize.width, mapSize.height};
+    } else if (region.x + region.width > mapSize.width || region.y + region.height > mapSize.height) {
+        return {"Bake region exceeds the map"};
+    }
+
+    std::vector<MeshViews> views;
+    views.reserve(meshes.size());
+    for (size_t meshIdx = 0; meshIdx < meshes.size(); meshIdx++) {
+        const auto& mesh = meshes[meshIdx];
+        assert(mesh->vertexAttribute(models::AttributeType::POSITION).size() ==
+               mesh->vertexAttribute(models::AttributeType::TEXCOORD).size());
+        views.emplace_back(*mesh, scene.transforms()[meshIdx]);
+    }
+
+    // Every tile only writes the texels inside of it and visits its triangles in serial order, which makes
+    // the result independent of the number of threads.
+    auto tiles = binTriangles(views, mapSize, region);
+    threads = std::max<size_t>(1, std::min(parallel::threads(threads), tiles.size()));
+    logging::debug("Coverage - rasterizing {} tiles on {} threads", tiles.size(), threads);
+
+    struct Scratch {
+        std::vector<CoverageTexel> slots = std::vector<CoverageTexel>(TILE_SIZE * TILE_SIZE);
+        std::vector<uint8_t> covered = std::vector<uint8_t>(TILE_SIZE * TILE_SIZE, 0);
+    };
+    std::vector<Scratch> scratch(threads);
+    std::vector<std::vector<CoverageTexel>> tileTexels(tiles.size());
+
+    const float uscale = mapSize.width;
+    const float vscale = mapSize.height;
+    parallel::forEach(tiles.size(), threads, [&](size_t tileIdx, size_t workerIdx) {
+        auto& workerScratch = scratch[workerIdx];
+        rasterizeTile(views, tiles[tileIdx], uscale, vscale, conservative, workerScratch.slots, workerScratch.covered, tileTexels[tileIdx]);
+    });
+
+    Result<Coverage> result{std::make_shared<Coverage>()};
+    auto& coverage = *result.value;
+    coverage.mapSize_ = mapSize;
+    coverage.region_ = region;
+    coverage.conservative_ = conservative;
+    size_t texelCount = 0;
+    for (const auto& texels : tileTexels) {
+        texelCount += texels.size();
+    }
+    coverage.texels_.reserve(texelCount);
+    for (auto& texels : tileTexels) {
+        coverage.texels_.insert(coverage.texels_.end(), texels.begin(), texels.end());
+        std::vector<CoverageTexel>().swap(texels);
+    }
+    logging::debug("Coverage - {} texels covered", coverage.texels_.size());
+
+    return result;
+}
+
+Result<Coverage> Coverage::Load(const std::filesystem::path& file, const BakeScene& scene) {
+    std::ifstream in(file, std::ios::binary | std::ios::ate);
+    if (!in.is_open()) {
+        return {"Cannot read coverage " + file.string()};
+    }
+    const auto fileSize = static_cast<uint64_t>(in.tellg());
+    in.seekg(0);
+
+    CoverageHeader header{};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != COVERAGE_MAGIC) {
+        return {"Not a coverage file: " + file.string()};
+    }
+    if (header.version != COVERAGE_VERSION) {
+        return {"Unsupported coverage version " + std::to_string(header.version) + ": " + file.string()};
+    }
+    if (header.sceneHash != sceneHash(scene)) {
+        return {"Coverage " + file.string() + " is of a different scene"};
+    }
+
+    // The texels index images of the region, so nothing outside of it may get in
+    const auto& region = header.region;
+    if (region.empty() || uint64_t{region.x} + region.width > header.mapWidth || uint64_t{region.y} + region.height > header.mapHeight) {
+        return {"Invalid coverage region in " + file.string()};
+    }
+    if (header.texelCount > uint64_t{region.width} * region.height ||
+        header.texelCount * sizeof(CoverageTexel) != fileSize - sizeof(header)) {
+        return {"Invalid coverage texel count in " + file.string()};
+    }
+
+    Result<Coverage> result{std::make_shared<Coverage>()};
+    auto& coverage = *result.value;
+    coverage.mapSize_ = {header.mapWidth, header.mapHeight};
+    coverage.region_ = region;
+    coverage.conservative_ = header.conservative != 0;
+    coverage.texels_.resize(header.texelCount);
+    in.read(reinterpret_cast<char*>(coverage.texels_.data()), coverage.texels_.size() * sizeof(CoverageTexel));
+    if (!in) {
+        return {"Truncated coverage " + file.string()};
+    }
+
+    const auto& meshes = scene.meshes();
+    for (const auto& texel : coverage.texels_) {
+        if (texel.x < region.x || texel.x - region.x >= region.width || texel.y < region.y || texel.y - region.y >= region.height ||
+            texel.mesh >= meshes.size() || uint64_t{texel.triangle} + 2 >= meshes[texel.mesh]->indices().size()) {
+            return {"Invalid coverage texel in " + file.string()};
+        }
+    }
+
+    return result;
+}
+
+void Coverage::save(const std::filesystem::path& file, const BakeScene& scene) const {
+    const CoverageHeader header{
+            COVERAGE_MAGIC,
+            COVERAGE_VERSION,
+            conservative_,
+            sceneHash(scene),
+            mapSize_.width,
+            mapSize_.height,
+            region_,
+            texels_.size(),
+    };
+    std::vector<uint8_t> data(sizeof(header) + texels_.size() * sizeof(CoverageTexel));
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data() + sizeof(header), texels_.data(), texels_.size() * sizeof(CoverageTexel));
+    file::writeFile(file, data, true);
+}
+
+Image Coverage::mask() const {
+    Image mask(region_.width, region_.height, 1);
+    auto* pixels = mask.data().data();
+    for (const auto& texel : texels_) {
+        pixels[(size_t) (texel.y - region_.y) * region_.width + (texel.x - region_.x)] = 255;
+    }
+    return mask;
+}
+
+DenoiseGuides Coverage::guides() const {
+    const size_t width = region_.width;
+    const size_t texelCount = width * region_.height;
+    DenoiseGuides guides{
+            .positions = std::vector<glm::vec3>(texelCount),
+            .normals = std::vector<glm::vec3>(texelCount),
+            .charts = std::vector<uint32_t>(texelCount, 0),
+    };
+
+    // Covered texels are marked with an unassigned chart first
+    const auto UNASSIGNED = std::numeric_limits<uint32_t>::max();
+    for (const auto& texel : texels_) {
+        const auto i = (size_t) (texel.y - region_.y) * width + (texel.x - region_.x);
+        guides.positions[i] = texel.position;
+        guides.normals[i] = texel.normal;
+        guides.charts[i] = UNASSIGNED;
+    }
+
+    uint32_t chart = 0;
+    std::vector<size_t> queue;
+    for (size_t start = 0; start < texelCount; start++) {
+        if (guides.charts[start] != UNASSIGNED) {
+            continue;
+        }
+
+        chart++;
+        guides.charts[start] = chart;
+        queue.assign(1, start);
+        while (!queue.empty()) {
+            const auto i = queue.back();
+            queue.pop_back();
+            const auto x = i % width;
+            for (auto neighbour : {x > 0 ? i - 1 : i, x + 1 < width ? i + 1 : i, i >= width ? i - width : i, i + width < texelCount ? i + width : i}) {
+                if (guides.charts[neighbour] == UNASSIGNED) {
+                    guides.charts[neighbour] = chart;
+                    queue.push_back(neighbour);
+                }
+            }
+        }
+    }
+    logging::debug("Coverage - {} charts", chart);
+
+    return guides;
+}
+
+} // namespace meshtools::ao
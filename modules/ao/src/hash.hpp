@@ -0,0 +1,57 @@
+#pragma once
+
+#include <meshtools/ao/bake_scene.hpp>
+#include <meshtools/models/mesh_data.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace meshtools::ao {
+
+// 64 bit FNV-1a
+struct Hasher {
+    void add(const void* data, size_t size) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+        }
+    }
+
+    template<class T>
+    void add(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        add(&value, sizeof(T));
+    }
+
+    void add(const models::TypedData& data) {
+        add(data.dataType());
+        add(data.componentCount());
+        add(data.buffer().data(), data.buffer().size());
+    }
+
+    // The geometry, normals, texture coordinates and transforms of the baked meshes, and every instance of their mesh
+    // groups, so that moving, adding or removing an occluding instance changes the hash as well
+    void add(const BakeScene& scene) {
+        for (size_t meshIdx = 0; meshIdx < scene.meshes().size(); meshIdx++) {
+            const auto& mesh = *scene.meshes()[meshIdx];
+            add(mesh.indices());
+            for (const auto& attribute : {models::AttributeType::POSITION, models::AttributeType::NORMAL, models::AttributeType::TEXCOORD}) {
+                if (mesh.hasVertexAttribute(attribute)) {
+                    add(mesh.vertexAttribute(attribute));
+                }
+            }
+            add(scene.transforms()[meshIdx]);
+        }
+
+        add(scene.instances().size());
+        for (const auto& instance : scene.instances()) {
+            add(instance.meshGroup);
+            add(instance.transform);
+        }
+    }
+
+    uint64_t hash = 0xcbf29ce484222325ull;
+};
+
+} // namespace meshtools::ao
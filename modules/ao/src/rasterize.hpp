@@ -1,77 +1,167 @@
 #pragma once
 
 #include <meshtools/math.hpp>
+#include <meshtools/simd.hpp>
 
 #include <algorithm>
 #include <array>
+#include <cmath>
 #include <cstdint>
-#include <cstdlib>
+#include <utility>
 
-static void SetPixel(uint8_t* dest, int destWidth, int x, int y, const std::vector<uint8_t>& color) {
-    const uint8_t channels = color.size();
-    uint8_t* pixel = &dest[x * channels + y * (destWidth * channels)];
-    for (size_t i = 0; i < channels; i++) {
-        pixel[i] = color[i];
+namespace meshtools::ao {
+
+namespace raster {
+
+// Vertices are snapped to 1/256 of a pixel; edge functions are evaluated exactly in 64 bit
+const constexpr int SUBPIXEL_BITS = 8;
+const constexpr int64_t SUBPIXEL = int64_t{1} << SUBPIXEL_BITS;
+const constexpr int64_t HALF_PIXEL = SUBPIXEL / 2;
+
+// Pixels are visited in square blocks of this size, which are skipped or accepted as a whole where possible
+const constexpr int BLOCK_SIZE = static_cast<int>(simd::WIDTH);
+
+// E(x, y) = a * x + b * y + c, positive on the inner side of the edge
+struct Edge {
+    Edge(const std::array<int64_t, 2>& from, const std::array<int64_t, 2>& to, bool conservative)
+        : a(from[1] - to[1]), b(to[0] - from[0]), c(from[0] * to[1] - from[1] * to[0]) {
+        if (conservative) {
+            // Moves the edge out, so it passes through the pixel corner that is furthest inside
+            bias = -(std::abs(a) + std::abs(b)) * HALF_PIXEL;
+        } else if (a < 0 || (a == 0 && b < 0)) {
+            // Top-left rule: pixel centers exactly on an edge belong to one of the two triangles that share it
+            bias = 1;
+        }
     }
-}
 
-// https://github.com/ssloy/tinyrenderer/wiki/Lesson-2:-Triangle-rasterization-and-back-face-culling
-template<int buffer = 2, class P = glm::vec<2, int, glm::defaultp>, class Fn>
-static void RasterizeTriangle(P t0, P t1, P t2, Fn&& fn) {
-    // Sort left to right
-    if (t0[0] > t1[0])
-        std::swap(t0, t1);
-    if (t0[0] > t2[0])
-        std::swap(t0, t2);
-    if (t1[0] > t2[0])
-        std::swap(t1, t2);
-
-
-    // Expand width
-    auto minX = t0[0];
-    auto maxX = t2[0];
-    t0[0] -= buffer;
-    if (t1[0] == minX) {
-        t1[0] = std::max(0, t1[0] - buffer);
-    } else if (t1[0] == maxX) {
-        t1[0] += buffer;
+    // At the center of pixel (x, y)
+    int64_t at(int x, int y) const {
+        return a * (x * SUBPIXEL + HALF_PIXEL) + b * (y * SUBPIXEL + HALF_PIXEL) + c;
+    }
+
+    int64_t a;
+    int64_t b;
+    int64_t c;
+    // Pixels with E >= bias are covered
+    int64_t bias = 0;
+};
+
+} // namespace raster
+
+// Half-space rasterizer. A pixel is covered when its center is inside the triangle, where centers exactly on an edge
+// follow the top-left rule, so triangles that share an edge never cover a pixel twice or leave a gap. Conservative
+// rasterization covers every pixel that the triangle touches at all instead; barycentrics of those pixels can lie
+// outside of [0, 1].
+//
+// Rows of BLOCK_SIZE pixels are tested at once with SIMD, and blocks that are completely outside (or inside) of the
+// triangle skip the per-pixel tests. fn(x, y, barycentric) is called for covered pixels inside the (inclusive) clip
+// rectangle, in rows from top to bottom; barycentrics are relative to p0, p1 and p2 at the pixel center.
+template<class Fn>
+void RasterizeTriangle(const glm::vec2& p0, const glm::vec2& p1, const glm::vec2& p2, int clipMinX, int clipMinY, int clipMaxX,
+                       int clipMaxY, bool conservative, Fn&& fn) {
+    using namespace raster;
+    using i64xN = int64_t __attribute__((vector_size(simd::WIDTH * sizeof(int64_t))));
+
+    auto snap = [](const glm::vec2& p) {
+        return std::array<int64_t, 2>{std::llround(p[0] * SUBPIXEL), std::llround(p[1] * SUBPIXEL)};
+    };
+    std::array<std::array<int64_t, 2>, 3> v{snap(p0), snap(p1), snap(p2)};
+
+    // Counter clockwise, so the edge functions are positive inside
+    auto area = (v[1][0] - v[0][0]) * (v[2][1] - v[0][1]) - (v[1][1] - v[0][1]) * (v[2][0] - v[0][0]);
+    if (area == 0) {
+        return;
     }
-    t2[0] += buffer;
-
-    // Sort bottom to top
-    if (t0[1] > t1[1])
-        std::swap(t0, t1);
-    if (t0[1] > t2[1])
-        std::swap(t0, t2);
-    if (t1[1] > t2[1])
-        std::swap(t1, t2);
-
-    // Expand height
-    auto minY = t0[1];
-    auto maxY = t2[1];
-    t0[1] = std::max(0, t0[1] - buffer);
-    if (t1[1] == minY) {
-        t1[1] = std::max(0, t1[1] - buffer);
-    } else if (t1[1] == maxY) {
-        t1[1] += buffer;
+    const bool flipped = area < 0;
+    if (flipped) {
+        std::swap(v[1], v[2]);
+        area = -area;
     }
-    t2[1] += buffer;
-
-    int total_height = t2[1] - t0[1];
-    for (int i = 0; i < total_height; i++) {
-        bool second_half = i > t1[1] - t0[1] || t1[1] == t0[1];
-        int segment_height = second_half ? t2[1] - t1[1] : t1[1] - t0[1];
-        float alpha = (float) i / total_height;
-        float beta = (float) (i - (second_half ? t1[1] - t0[1] : 0)) / segment_height;
-        std::array<int, 2> A{}, B{};
-        for (int j = 0; j < 2; j++) {
-            A[j] = int(t0[j] + (t2[j] - t0[j]) * alpha);
-            B[j] = int(second_half ? t1[j] + (t2[j] - t1[j]) * beta : t0[j] + (t1[j] - t0[j]) * beta);
+
+    // Edge i is opposite of vertex i, its function divided by the area is the barycentric of vertex i
+    const std::array<Edge, 3> edges{Edge{v[1], v[2], conservative}, Edge{v[2], v[0], conservative}, Edge{v[0], v[1], conservative}};
+
+    // Pixels that the bounding box touches
+    auto minX = std::max<int>(clipMinX, std::floor(std::min({p0[0], p1[0], p2[0]})));
+    auto minY = std::max<int>(clipMinY, std::floor(std::min({p0[1], p1[1], p2[1]})));
+    auto maxX = std::min<int>(clipMaxX, std::floor(std::max({p0[0], p1[0], p2[0]})));
+    auto maxY = std::min<int>(clipMaxY, std::floor(std::max({p0[1], p1[1], p2[1]})));
+    if (minX > maxX || minY > maxY) {
+        return;
+    }
+
+    const float invArea = 1.0f / static_cast<float>(area);
+    i64xN lanes;
+    for (int i = 0; i < BLOCK_SIZE; i++) {
+        lanes[i] = i;
+    }
+    std::array<i64xN, 3> laneSteps;
+    for (int e = 0; e < 3; e++) {
+        laneSteps[e] = lanes * (edges[e].a * SUBPIXEL);
+    }
+
+    // Edge values at the corners of a block are its extremes, relative to the pixel center at its top left
+    const int64_t blockSpan = (BLOCK_SIZE - 1) * SUBPIXEL;
+    std::array<int64_t, 3> blockMax{};
+    std::array<int64_t, 3> blockMin{};
+    for (int e = 0; e < 3; e++) {
+        blockMax[e] = std::max<int64_t>(edges[e].a, 0) * blockSpan + std::max<int64_t>(edges[e].b, 0) * blockSpan;
+        blockMin[e] = std::min<int64_t>(edges[e].a, 0) * blockSpan + std::min<int64_t>(edges[e].b, 0) * blockSpan;
+    }
+
+    auto emit = [&](int x, int y, int64_t w0, int64_t w1, int64_t w2) {
+        glm::vec3 bc{static_cast<float>(w0) * invArea, static_cast<float>(w1) * invArea, static_cast<float>(w2) * invArea};
+        if (flipped) {
+            std::swap(bc[1], bc[2]);
         }
-        if (A[0] > B[0])
-            std::swap(A, B);
-        for (int j = A[0]; j <= B[0]; j++) {
-            fn(j, t0[1] + i);
+        fn(x, y, bc);
+    };
+
+    for (int blockY = minY; blockY <= maxY; blockY += BLOCK_SIZE) {
+        const int endY = std::min(maxY, blockY + BLOCK_SIZE - 1);
+        for (int blockX = minX; blockX <= maxX; blockX += BLOCK_SIZE) {
+            const int endX = std::min(maxX, blockX + BLOCK_SIZE - 1);
+
+            std::array<int64_t, 3> corner{};
+            bool outside = false;
+            bool inside = true;
+            for (int e = 0; e < 3; e++) {
+                corner[e] = edges[e].at(blockX, blockY);
+                outside |= corner[e] + blockMax[e] < edges[e].bias;
+                inside &= corner[e] + blockMin[e] >= edges[e].bias;
+            }
+            if (outside) {
+                continue;
+            }
+
+            // The edge values step by a (b) per pixel to the right (down)
+            for (int y = blockY; y <= endY; y++) {
+                const auto row = y - blockY;
+                const int64_t w0 = corner[0] + edges[0].b * SUBPIXEL * row;
+                const int64_t w1 = corner[1] + edges[1].b * SUBPIXEL * row;
+                const int64_t w2 = corner[2] + edges[2].b * SUBPIXEL * row;
+
+                if (inside) {
+                    for (int x = blockX; x <= endX; x++) {
+                        const auto column = x - blockX;
+                        emit(x, y, w0 + edges[0].a * SUBPIXEL * column, w1 + edges[1].a * SUBPIXEL * column, w2 + edges[2].a * SUBPIXEL * column);
+                    }
+                    continue;
+                }
+
+                const i64xN e0 = w0 + laneSteps[0];
+                const i64xN e1 = w1 + laneSteps[1];
+                const i64xN e2 = w2 + laneSteps[2];
+                const i64xN covered = (e0 >= edges[0].bias) & (e1 >= edges[1].bias) & (e2 >= edges[2].bias);
+                for (int x = blockX; x <= endX; x++) {
+                    const auto column = x - blockX;
+                    if (covered[column]) {
+                        emit(x, y, e0[column], e1[column], e2[column]);
+                    }
+                }
+            }
         }
     }
 }
+
+} // namespace meshtools::ao
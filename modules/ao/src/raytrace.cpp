@@ -1,215 +1,594 @@
 #include "raytrace.hpp"
 
-#include "rasterize.hpp"
+#include "bake_scene_impl.hpp"
+#include "checkpoint.hpp"
+#include "sampler.hpp"
 
 #include <meshtools/logging.hpp>
 #include <meshtools/math.hpp>
 #include <meshtools/models/model.hpp>
+#include <meshtools/parallel.hpp>
+#include <meshtools/simd.hpp>
 
-#include <embree3/rtcore.h>
 #include <embree3/rtcore_ray.h>
 
 #include <array>
 #include <cassert>
+#include <chrono>
 #include <cmath>
+#include <cstring>
 #include <memory>
-#include <random>
+#include <mutex>
+#include <numeric>
 #include <vector>
 
 using namespace std;
 
 namespace meshtools::ao {
 
-template<class T>
-T sign(std::array<T, 2> p1, std::array<T, 2> p2, std::array<T, 2> p3) {
-    return (p1[0] - p3[0]) * (p2[1] - p3[1]) - (p2[0] - p3[0]) * (p1[1] - p3[1]);
+namespace {
+
+// Number of vertices per task of a vertex bake
+const constexpr uint32_t VERTEX_CHUNK_SIZE = 1024;
+
+// Texel rays start on the surface, and skip this far along the ray to get clear of it. Vertex rays start
+// vertexOffset off the surface instead and are traced from there.
+const constexpr float TEXEL_NEAR = 0.5f;
+
+// A texel waiting to be traced
+struct Texel {
+    int x;
+    int y;
+    glm::vec3 org;
+    glm::vec3 normal;
+    uint32_t hits = 0;
+    uint32_t samples = 0;
+
+    Rotation rotation() const {
+        return texelRotation(x, y);
+    }
+};
+
+// A sample point of a vertex waiting to be traced: the vertex itself, or a point in one of its triangles
+struct VertexSample {
+    uint32_t vertex;
+    // Seeds the rotation of the sample directions, so that the points of a vertex (and the vertices of the meshes) don't
+    // share theirs. The mesh for a point at the vertex, the triangle for one inside a triangle.
+    uint32_t seed;
+    glm::vec3 org;
+    glm::vec3 normal;
+    uint32_t hits = 0;
+    uint32_t samples = 0;
+
+    Rotation rotation() const {
+        return texelRotation(static_cast<int>(vertex), static_cast<int>(seed));
+    }
+};
+
+// Rays in the SoA layout embree expects for streams (RTCRayNp)
+struct RayStream {
+    void resize(size_t size) {
+        // Padded so the SIMD ray setup may run past the last ray
+        auto capacity = size + simd::WIDTH;
+        if (orgX.size() >= capacity) {
+            return;
+        }
+
+        for (auto* component : {&orgX, &orgY, &orgZ, &tnear, &dirX, &dirY, &dirZ, &time, &tfar}) {
+            component->resize(capacity);
+        }
+        mask.resize(capacity, std::numeric_limits<unsigned int>::max());
+        id.resize(capacity);
+        flags.resize(capacity);
+    }
+
+    RTCRayNp rays() {
+        return {
+                orgX.data(),
+                orgY.data(),
+                orgZ.data(),
+                tnear.data(),
+                dirX.data(),
+                dirY.data(),
+                dirZ.data(),
+                time.data(),
+                tfar.data(),
+                mask.data(),
+                id.data(),
+                flags.data(),
+        };
+    }
+
+    std::vector<float> orgX;
+    std::vector<float> orgY;
+    std::vector<float> orgZ;
+    std::vector<float> tnear;
+    std::vector<float> dirX;
+    std::vector<float> dirY;
+    std::vector<float> dirZ;
+    std::vector<float> time;
+    std::vector<float> tfar;
+    std::vector<unsigned int> mask;
+    std::vector<unsigned int> id;
+    std::vector<unsigned int> flags;
+};
+
+// Scratch state owned by a single worker
+struct Worker {
+    Worker() {
+        rtcInitIntersectContext(&ctx);
+        // Rays of a stream share their origin per texel and fan out over the same hemisphere
+        ctx.flags = RTC_INTERSECT_CONTEXT_FLAG_COHERENT;
+    }
+
+    std::vector<Texel> texels;
+    std::vector<VertexSample> vertexSamples;
+    RayStream stream;
+    RTCIntersectContext ctx{};
+
+    // Adaptive sampling bookkeeping
+    std::vector<size_t> active;
+    std::vector<uint32_t> batches;
+
+    // Stats
+    size_t texelCount = 0;
+    size_t rayCount = 0;
+};
+
+// Copies the texels of the finished chunks
+void copyChunks(const Coverage& coverage, const std::vector<uint8_t>& done, const Image& source, Image& target) {
+    const auto& texels = coverage.texels();
+    const auto& region = coverage.region();
+    const size_t channels = source.channels();
+    for (size_t chunk = 0; chunk < done.size(); chunk++) {
+        if (!done[chunk]) {
+            continue;
+        }
+        const auto end = std::min(texels.size(), (chunk + 1) * TEXEL_CHUNK_SIZE);
+        for (auto i = chunk * TEXEL_CHUNK_SIZE; i < end; i++) {
+            const size_t offset = ((texels[i].y - region.y) * static_cast<size_t>(region.width) + (texels[i].x - region.x)) * channels;
+            std::memcpy(target.data().data() + offset, source.data().data() + offset, channels);
+        }
+    }
+}
+
+// Emits `count` rays for a texel or vertex sample, using the samples starting at `first`
+template <typename Point>
+void emitRays(RayStream& stream, size_t offset, const Point& texel, const SampleSet& samples, size_t first, size_t count, float near,
+              float far) {
+    const auto orgX = simd::broadcast(texel.org[0]);
+    const auto orgY = simd::broadcast(texel.org[1]);
+    const auto orgZ = simd::broadcast(texel.org[2]);
+    const auto tnear = simd::broadcast(near);
+    const auto tfar = simd::broadcast(far);
+
+    // Runs past count into the next texel's range (or the stream padding), which is overwritten next
+    for (size_t i = 0; i < count; i += simd::WIDTH) {
+        simd::store(&stream.orgX[offset + i], orgX);
+        simd::store(&stream.orgY[offset + i], orgY);
+        simd::store(&stream.orgZ[offset + i], orgZ);
+        simd::store(&stream.tnear[offset + i], tnear);
+        simd::store(&stream.tfar[offset + i], tfar);
+    }
+
+    emitDirections(samples,
+                   first,
+                   count,
+                   texel.normal,
+                   texel.rotation(),
+                   &stream.dirX[offset],
+                   &stream.dirY[offset],
+                   &stream.dirZ[offset]);
 }
 
-// http://www.altdevblogaday.com/2012/05/03/generating-uniformly-distributed-points-on-sphere/
-glm::vec3 random_direction(std::mt19937& rnd) {
-    double z = 2.0f * rnd() / double(std::mt19937::max()) - 1.0;
-    double t = 2.0f * rnd() / double(std::mt19937::max()) * M_PI;
-    double r = sqrt(1.0 - z * z);
-    return {r * cosf(t), r * sinf(t), z};
+// Half width of the Wilson score 95% confidence interval of the visibility estimate. Unlike the normal
+// approximation, it doesn't collapse to zero when all or none of the rays hit, so those texels aren't taken to be
+// exact after a handful of samples.
+float confidence(uint32_t hits, uint32_t samples) {
+    const float z = 1.96f;
+    const float z2 = z * z;
+    const auto n = (float) samples;
+    float p = (float) hits / n;
+    return z / (1.0f + z2 / n) * std::sqrt(p * (1.0f - p) / n + z2 / (4.0f * n * n));
 }
 
-Result<Image> raytrace(const std::vector<std::shared_ptr<models::Mesh>>& meshes, const Size<uint32_t>& size, RaytraceOptions options) {
-    if (std::any_of(meshes.begin(), meshes.end(), [](const std::shared_ptr<models::Mesh>& mesh) {
-            return !mesh->hasVertexAttribute(models::AttributeType::TEXCOORD);
-        })) {
-        return {"Cannot raytrace models without texture coordinates"};
+// Traces all queued texels (or vertex samples). Texels get nsamples rays each in a single round, or in adaptive mode,
+// rounds of batchSamples rays (minSamples in the first) until their estimate is tight enough. Rays start `near` from
+// the texel.
+template <typename Point>
+void traceRays(Worker& worker, std::vector<Point>& texels, RTCScene scene, const SampleSet& samples, const RaytraceOptions& options,
+               float near) {
+    const uint32_t maxSamples = samples.count;
+    const uint32_t firstBatch = options.adaptive ? std::clamp<uint32_t>(options.minSamples, 1, maxSamples) : maxSamples;
+    const uint32_t nextBatch = std::max<uint32_t>(1, options.batchSamples);
+    auto& stream = worker.stream;
+
+    std::vector<size_t>& active = worker.active;
+    active.resize(texels.size());
+    std::iota(active.begin(), active.end(), 0);
+
+    while (!active.empty()) {
+        // Prepare rays to shoot through the differential hemisphere.
+        auto& batches = worker.batches;
+        batches.resize(active.size());
+        size_t rayCount = 0;
+        for (size_t a = 0; a < active.size(); a++) {
+            const auto& texel = texels[active[a]];
+            batches[a] = std::min(texel.samples == 0 ? firstBatch : nextBatch, maxSamples - texel.samples);
+            rayCount += batches[a];
+        }
+
+        stream.resize(rayCount);
+        size_t offset = 0;
+        for (size_t a = 0; a < active.size(); a++) {
+            const auto& texel = texels[active[a]];
+            emitRays(stream, offset, texel, samples, texel.samples, batches[a], near, options.far);
+            offset += batches[a];
+        }
+
+        auto rays = stream.rays();
+        rtcOccludedNp(scene, &worker.ctx, &rays, rayCount);
+        worker.rayCount += rayCount;
+
+        // Reduce the hits per texel and retire the ones that are done
+        offset = 0;
+        size_t remaining = 0;
+        for (size_t a = 0; a < active.size(); a++) {
+            auto& texel = texels[active[a]];
+            for (size_t i = 0; i < batches[a]; i++) {
+                if (stream.tfar[offset + i] == -std::numeric_limits<float>::infinity()) {
+                    texel.hits++;
+                }
+            }
+            offset += batches[a];
+            texel.samples += batches[a];
+
+            bool done = texel.samples >= maxSamples ||
+                        (options.adaptive && confidence(texel.hits, texel.samples) * options.multiply <= options.tolerance);
+            if (!done) {
+                active[remaining++] = active[a];
+            }
+        }
+        active.resize(remaining);
     }
 
-    if (std::any_of(meshes.begin(), meshes.end(), [](const std::shared_ptr<models::Mesh>& mesh) {
-            return !mesh->hasVertexAttribute(models::AttributeType::NORMAL);
-        })) {
-        return {"Cannot raytrace models without normals"};
+    worker.texelCount += texels.size();
+}
+
+template <typename Point>
+float occlusion(const Point& texel, const RaytraceOptions& options) {
+    return options.multiply * (1.0f - (float) texel.hits / (float) texel.samples);
+}
+
+// Traces all queued texels and writes the results
+void traceTexels(Worker& worker, RTCScene scene, const SampleSet& samples, Image& image, const RaytraceOptions& options) {
+    auto& texels = worker.texels;
+    traceRays(worker, texels, scene, samples, options, TEXEL_NEAR);
+
+    // The image covers the region
+    const auto width = image.width();
+    const auto channels = image.channels();
+    const int regionX = options.region.x;
+    const int regionY = options.region.y;
+    auto* pixels = image.data().data();
+    for (const auto& texel : texels) {
+        uint8_t result = std::min(255.0f, 255.0f * occlusion(texel, options));
+        auto* pixel = &pixels[((size_t) (texel.y - regionY) * width + (texel.x - regionX)) * channels];
+        std::fill_n(pixel, channels, result);
+        if (channels == 4) {
+            pixel[3] = 255;
+        }
     }
 
-    logging::debug("Ray trace - setting up scene");
+    texels.clear();
+}
 
-    // Create the embree device and scene.
-    RTCDevice device = rtcNewDevice(nullptr);
-    assert(device && "Unable to create embree device.");
-    RTCScene scene = rtcNewScene(device);
-    assert(scene);
+// Per mesh state of a vertex bake
+struct VertexMesh {
+    explicit VertexMesh(const models::Mesh& mesh) : indices(mesh.indices<uint32_t>()) {}
+
+    models::DataView<uint32_t> indices;
+    // In world space
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+
+    // Adjacent triangles per vertex, the ones of vertex i are in triangles[offsets[i]..offsets[i + 1])
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    // Summed occlusion and number of sample points per vertex
+    std::vector<float> occlusion;
+    std::vector<uint32_t> points;
+};
+
+glm::vec3 faceNormal(const VertexMesh& vertexMesh, uint32_t j) {
+    const auto& p0 = vertexMesh.positions[vertexMesh.indices[j]];
+    const auto& p1 = vertexMesh.positions[vertexMesh.indices[j + 1]];
+    const auto& p2 = vertexMesh.positions[vertexMesh.indices[j + 2]];
+    // Not normalized, so it is weighted by the triangle area
+    return glm::cross(p1 - p0, p2 - p0);
+}
 
-    for (const auto& mesh : meshes) {
-        auto positions = mesh->vertexAttribute<glm::vec3>(models::AttributeType::POSITION);
-        // Populate the embree mesh.
-        // TODO: Backface culling
-        auto* geometry = rtcNewGeometry(device, RTC_GEOMETRY_TYPE_TRIANGLE);
-        assert(geometry);
-        auto* vertices =
-                rtcSetNewGeometryBuffer(geometry, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, positions.stride(), positions.size());
-        assert(vertices);
-        positions.copyTo(vertices);
+glm::vec3 safeNormalize(const glm::vec3& v) {
+    auto length = glm::length(v);
+    return length > 0.0f ? v / length : glm::vec3{0.0f, 0.0f, 1.0f};
+}
 
-        auto indices = mesh->indices<uint32_t>();
-        auto* triangles =
-                rtcSetNewGeometryBuffer(geometry, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3, 3 * sizeof(uint32_t), indices.size() / 3);
-        assert(triangles);
-        indices.copyTo(triangles);
+void setupVertexMesh(const models::Mesh& mesh, const glm::mat4& transform, bool averageTriangles, VertexMesh& vertexMesh) {
+    const auto& indices = vertexMesh.indices;
+    const auto triangleEnd = indices.size() - indices.size() % 3;
 
-        rtcCommitGeometry(geometry);
-        rtcAttachGeometry(scene, geometry);
-        rtcReleaseGeometry(geometry);
+    auto positions = mesh.vertexAttribute<glm::vec3>(models::AttributeType::POSITION);
+    const auto vertexCount = positions.size();
+    vertexMesh.positions.reserve(vertexCount);
+    for (const auto& position : positions) {
+        vertexMesh.positions.emplace_back(transform * glm::vec4{position, 1.0f});
     }
 
+    if (mesh.hasVertexAttribute(models::AttributeType::NORMAL)) {
+        const glm::mat3 normalTransform = glm::transpose(glm::inverse(glm::mat3{transform}));
+        auto normals = mesh.vertexAttribute<glm::vec3>(models::AttributeType::NORMAL);
+        vertexMesh.normals.reserve(vertexCount);
+        for (const auto& normal : normals) {
+            vertexMesh.normals.push_back(safeNormalize(normalTransform * normal));
+        }
+    } else {
+        vertexMesh.normals.assign(vertexCount, glm::vec3{0.0f});
+        for (uint32_t j = 0; j < triangleEnd; j += 3) {
+            auto normal = faceNormal(vertexMesh, j);
+            for (uint32_t k = 0; k < 3; k++) {
+                vertexMesh.normals[indices[j + k]] += normal;
+            }
+        }
+        for (auto& normal : vertexMesh.normals) {
+            normal = safeNormalize(normal);
+        }
+    }
 
-    rtcCommitScene(scene);
+    if (averageTriangles) {
+        auto& offsets = vertexMesh.offsets;
+        offsets.assign(vertexCount + 1, 0);
+        for (uint32_t j = 0; j < triangleEnd; j++) {
+            offsets[indices[j] + 1]++;
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
 
-    auto image = std::make_shared<Image>(size.width, size.width, options.resultChannels);
-    const float uscale = size.width;
-    const float vscale = size.height;
+        auto next = offsets;
+        vertexMesh.triangles.resize(triangleEnd);
+        for (uint32_t j = 0; j < triangleEnd; j++) {
+            vertexMesh.triangles[next[indices[j]]++] = j - j % 3;
+        }
+    }
 
-    const float E = 0.5f;
-    std::vector<RTCRay> rays;
-    rays.resize(options.nsamples);
+    vertexMesh.occlusion.assign(vertexCount, 0.0f);
+    vertexMesh.points.assign(vertexCount, 0);
+}
 
-    RTCIntersectContext ctx{};
-    rtcInitIntersectContext(&ctx);
-
-    // Prep "random dirs"
-    std::mt19937 rnd(0);
-    std::vector<glm::vec3> randomDirs;
-    randomDirs.reserve(options.nsamples);
-    for (size_t i = 0; i < options.nsamples; i++) {
-        randomDirs.push_back(random_direction(rnd));
-    }
-
-    for (const auto& mesh : meshes) {
-        assert(mesh->hasVertexAttribute(models::AttributeType::TEXCOORD));
-        assert(mesh->vertexAttribute(models::AttributeType::POSITION).size() ==
-               mesh->vertexAttribute(models::AttributeType::TEXCOORD).size());
-        auto indexCount = mesh->indices().size();
-        logging::debug("Ray trace - tracing {} triangles", indexCount / 3);
-
-        auto indexView = mesh->indices<uint32_t>();
-        auto positionsView = mesh->vertexAttribute<glm::vec3>(models::AttributeType::POSITION);
-        auto normalsView = mesh->vertexAttribute<glm::vec3>(models::AttributeType::NORMAL);
-        auto texcoordsView = mesh->vertexAttribute<glm::vec2>(models::AttributeType::TEXCOORD);
-
-        for (uint32_t j = 0; j < indexCount; j += 3) {
-            //            logging::debug("Rasterizing {}/{}", j / 3, indexCount / 3);
-            struct Vertex {
-                Vertex(glm::vec3 pos, glm::vec3 norm, glm::vec2 tex)
-                    : position(pos), normal(norm), uv(tex), uv3({tex[0], tex[1], 0.0f}),
-                      uv2i({static_cast<int>(tex[0]), static_cast<int>(tex[1])}){
-
-                      };
-                Vertex() = default;
-
-                glm::vec3 position;
-                glm::vec3 normal;
-                glm::vec2 uv;
-                glm::vec3 uv3;
-                glm::vec<2, int, glm::defaultp> uv2i;
-            };
-            std::array<Vertex, 3> triangle{};
-            for (size_t k = 0; k < 3; k++) {
-                auto index = indexView[j + k];
-                assert(texcoordsView.size() > index);
-                auto uv = texcoordsView[index];
-                uv[0] *= uscale;
-                uv[1] *= vscale;
-                std::clamp(uv[0], 0.0f, (float) image->width());
-                std::clamp(uv[1], 0.0f, (float) image->height());
-                assert(uv[0] <= image->width());
-                assert(uv[1] <= image->height());
-                triangle[k] = {positionsView[index], normalsView[index], uv};
-            }
+// Queues the sample points of a vertex: the vertex itself, or a point inside each adjacent triangle
+void queueVertex(Worker& worker, const VertexMesh& vertexMesh, uint32_t meshIdx, uint32_t vertex, const RaytraceOptions& options) {
+    const auto& position = vertexMesh.positions[vertex];
+    const auto begin = vertexMesh.offsets.empty() ? 0 : vertexMesh.offsets[vertex];
+    const auto end = vertexMesh.offsets.empty() ? 0 : vertexMesh.offsets[vertex + 1];
+    if (begin == end) {
+        const auto& normal = vertexMesh.normals[vertex];
+        worker.vertexSamples.push_back({vertex, meshIdx, position + normal * options.vertexOffset, normal});
+        return;
+    }
 
-            if (!triangle[0].uv3[0] && !triangle[0].uv3[1] && !triangle[1].uv3[0] && !triangle[1].uv3[1] && !triangle[2].uv3[0] &&
-                !triangle[2].uv3[1]) {
-                continue; // Skip triangles that weren't atlased.
+    for (auto i = begin; i < end; i++) {
+        auto j = vertexMesh.triangles[i];
+        auto normal = safeNormalize(faceNormal(vertexMesh, j));
+        auto centroid = (vertexMesh.positions[vertexMesh.indices[j]] + vertexMesh.positions[vertexMesh.indices[j + 1]] +
+                         vertexMesh.positions[vertexMesh.indices[j + 2]]) /
+                        3.0f;
+        // Pulled a bit towards the centroid, to get away from the edges that are shared with the other triangles
+        auto org = position + (centroid - position) * 0.25f + normal * options.vertexOffset;
+        worker.vertexSamples.push_back({vertex, j, org, normal});
+    }
+}
+
+// Traces all queued sample points and adds their results to the vertices
+void traceVertices(Worker& worker, RTCScene scene, const SampleSet& samples, VertexMesh& vertexMesh, const RaytraceOptions& options) {
+    // The sample points are already vertexOffset off the surface
+    traceRays(worker, worker.vertexSamples, scene, samples, options, 0.0f);
+    for (const auto& point : worker.vertexSamples) {
+        vertexMesh.occlusion[point.vertex] += occlusion(point, options);
+        vertexMesh.points[point.vertex]++;
+    }
+    worker.vertexSamples.clear();
+}
+
+BakeStats sumStats(const std::vector<Worker>& workers) {
+    BakeStats totals{};
+    for (const auto& worker : workers) {
+        totals.texels += worker.texelCount;
+        totals.rays += worker.rayCount;
+    }
+    return totals;
+}
+
+} // namespace
+
+Result<Image> raytrace(const BakeScene& bakeScene, const Size<uint32_t>& size, RaytraceOptions options, BakeStats* stats) {
+    auto coverageResult = Coverage::Create(bakeScene, size, options.region, options.threads, options.conservative);
+    if (!coverageResult) {
+        return {std::move(coverageResult.error)};
+    }
+    return raytrace(bakeScene, *coverageResult.value, options, stats);
+}
+
+Result<Image> raytrace(const BakeScene& bakeScene, const Coverage& coverage, RaytraceOptions options, BakeStats* stats) {
+    if (options.nsamples <= 0) {
+        return {"Number of samples must be positive"};
+    }
+
+    RTCScene scene = bakeScene.impl().scene;
+    const auto& texels = coverage.texels();
+    options.region = coverage.region();
+
+    auto image = std::make_shared<Image>(options.region.width, options.region.height, options.resultChannels);
+
+    const SampleSet samples{options.sampler, static_cast<size_t>(options.nsamples)};
+
+    // Every texel is in exactly one chunk, so the result is independent of the number of threads and of the order
+    // in which chunks are processed.
+    const auto chunks = (texels.size() + TEXEL_CHUNK_SIZE - 1) / TEXEL_CHUNK_SIZE;
+    auto threads = std::max<size_t>(1, std::min(parallel::threads(options.threads), chunks));
+    logging::debug("Ray trace - tracing {} texel chunks on {} threads", chunks, threads);
+
+    // Finished chunks, restored from and periodically saved to the checkpoint
+    std::vector<uint8_t> done(chunks, 0);
+    uint64_t hash = 0;
+    if (!options.checkpoint.empty()) {
+        hash = checkpointHash(bakeScene, coverage.mapSize(), options);
+        if (options.resume) {
+            if (auto restored = loadCheckpoint(options.checkpoint, hash, chunks, *image)) {
+                done = std::move(*restored);
+                logging::info("Resuming bake, {} of {} chunks are done", std::count(done.begin(), done.end(), 1), chunks);
             }
+        }
+    }
 
-            const constexpr int buffer = 0;
-            RasterizeTriangle<buffer>(triangle[0].uv2i, triangle[1].uv2i, triangle[2].uv2i, [&](auto x, auto y) {
-                if (x < 0 || y < 0 || !(x < image->width()) || !(y < image->height())) {
-                    return;
-                }
+    std::mutex checkpointMutex;
+    using Clock = std::chrono::steady_clock;
+    auto lastCheckpoint = Clock::now();
+    const auto checkpointInterval = std::chrono::duration<double>(options.checkpointInterval);
 
-                // Interpolate normal
-                auto bc = barycentric(triangle[0].uv3,
-                                      triangle[1].uv3,
-                                      triangle[2].uv3,
-                                      glm::vec3{static_cast<float>(x), static_cast<float>(y), 0});
-                glm::vec3 normal{
-                        triangle[0].normal[0] * bc[0] + triangle[1].normal[0] * bc[1] + triangle[2].normal[0] * bc[2],
-                        triangle[0].normal[1] * bc[0] + triangle[1].normal[1] * bc[1] + triangle[2].normal[1] * bc[2],
-                        triangle[0].normal[2] * bc[0] + triangle[1].normal[2] * bc[1] + triangle[2].normal[2] * bc[2],
-                };
-                normal = glm::normalize(normal);
-
-                // Interpolate origin
-                glm::vec3 org{triangle[0].position[0] * bc[0] + triangle[1].position[0] * bc[1] + triangle[2].position[0] * bc[2],
-                              triangle[0].position[1] * bc[0] + triangle[1].position[1] * bc[1] + triangle[2].position[1] * bc[2],
-                              triangle[0].position[2] * bc[0] + triangle[1].position[2] * bc[1] + triangle[2].position[2] * bc[2]};
-
-                // Prepare rays to shoot through the differential hemisphere.
-                for (size_t i = 0; i < rays.size(); i++) {
-                    auto& ray = rays[i];
-                    ray.org_x = org[0];
-                    ray.org_y = org[1];
-                    ray.org_z = org[2];
-                    ray.tnear = E;
-                    ray.tfar = options.far;
-
-                    auto dir = randomDirs[i];
-                    if (glm::dot(dir, normal) < 0.0)
-                        dir = scale(dir, -1.0f);
-
-                    ray.dir_x = dir[0];
-                    ray.dir_y = dir[1];
-                    ray.dir_z = dir[2];
-                }
-                rtcOccluded1M(scene, &ctx, rays.data(), options.nsamples, sizeof(RTCRay));
+    std::vector<Worker> workers(threads);
+    const size_t streamSize = std::max<size_t>(1, options.streamSize);
 
-                int nhits = 0;
-                for (auto& ray : rays) {
-                    if (ray.tfar == -std::numeric_limits<float>::infinity()) {
-                        nhits++;
-                    }
-                }
+    parallel::forEach(chunks, threads, [&](size_t chunk, size_t workerIdx) {
+        if (done[chunk]) {
+            return;
+        }
 
-                float ao = options.multiply * (1.0f - (float) nhits / (float) options.nsamples);
-                uint8_t result = std::min(255.0f, 255.0f * ao);
-                std::vector<uint8_t> color{result};
-                if (image->channels() == 4) {
-                    color[3] = 255;
-                }
-                SetPixel(image->data().data(), image->width(), x, y, color);
-            });
+        auto& worker = workers[workerIdx];
+        const auto end = std::min(texels.size(), (chunk + 1) * TEXEL_CHUNK_SIZE);
+        for (auto i = chunk * TEXEL_CHUNK_SIZE; i < end; i++) {
+            const auto& texel = texels[i];
+            worker.texels.push_back({static_cast<int>(texel.x), static_cast<int>(texel.y), texel.position, texel.normal});
+            if (worker.texels.size() == streamSize) {
+                traceTexels(worker, scene, samples, *image, options);
+            }
+        }
+
+        if (!worker.texels.empty()) {
+            traceTexels(worker, scene, samples, *image, options);
+        }
+
+        if (options.checkpoint.empty()) {
+            return;
+        }
+
+        // Only texels of finished chunks go into the checkpoint, the others may still be written to
+        std::lock_guard lock(checkpointMutex);
+        done[chunk] = 1;
+        if (Clock::now() - lastCheckpoint < checkpointInterval) {
+            return;
         }
+        Image partial(image->width(), image->height(), image->channels());
+        copyChunks(coverage, done, *image, partial);
+        saveCheckpoint(options.checkpoint, hash, done, partial);
+        lastCheckpoint = Clock::now();
+        logging::debug("Ray trace - saved checkpoint with {} of {} chunks", std::count(done.begin(), done.end(), 1), chunks);
+    });
+
+    if (!options.checkpoint.empty()) {
+        std::error_code error;
+        std::filesystem::remove(options.checkpoint, error);
     }
 
-    // Free all embree data.
-    rtcReleaseScene(scene);
-    rtcReleaseDevice(device);
+    if (options.gutter > 0) {
+        image->dilate(coverage.mask(), options.gutter, options.threads);
+    }
+
+    auto totals = sumStats(workers);
+    logging::debug("Ray trace - traced {} rays for {} texels ({} rays per texel)", totals.rays, totals.texels, totals.raysPerTexel());
+    if (stats) {
+        *stats = totals;
+    }
 
     return Result<Image>{std::move(image)};
 }
 
-} // namespace meshtools::ao
\ No newline at end of file
+Result<BakeStats> raytraceVertices(const BakeScene& bakeScene, RaytraceOptions options) {
+    if (options.nsamples <= 0) {
+        return {"Number of samples must be positive"};
+    }
+
+    const auto& meshes = bakeScene.meshes();
+    RTCScene scene = bakeScene.impl().scene;
+
+    const SampleSet samples{options.sampler, static_cast<size_t>(options.nsamples)};
+
+    std::vector<VertexMesh> vertexMeshes;
+    vertexMeshes.reserve(meshes.size());
+    for (size_t meshIdx = 0; meshIdx < meshes.size(); meshIdx++) {
+        const auto& mesh = *meshes[meshIdx];
+        setupVertexMesh(mesh, bakeScene.transforms()[meshIdx], options.averageTriangles, vertexMeshes.emplace_back(mesh));
+    }
+
+    // Tasks are chunks of vertices, every vertex is written by exactly one of them
+    struct Chunk {
+        uint32_t mesh;
+        uint32_t begin;
+        uint32_t end;
+    };
+    std::vector<Chunk> chunks;
+    for (uint32_t meshIdx = 0; meshIdx < vertexMeshes.size(); meshIdx++) {
+        const auto vertexCount = static_cast<uint32_t>(vertexMeshes[meshIdx].positions.size());
+        for (uint32_t begin = 0; begin < vertexCount; begin += VERTEX_CHUNK_SIZE) {
+            chunks.push_back({meshIdx, begin, std::min(begin + VERTEX_CHUNK_SIZE, vertexCount)});
+        }
+    }
+
+    auto threads = std::max<size_t>(1, std::min(parallel::threads(options.threads), chunks.size()));
+    logging::debug("Ray trace - tracing {} vertex chunks on {} threads", chunks.size(), threads);
+
+    std::vector<Worker> workers(threads);
+    const size_t streamSize = std::max<size_t>(1, options.streamSize);
+
+    parallel::forEach(chunks.size(), threads, [&](size_t chunkIdx, size_t workerIdx) {
+        const auto& chunk = chunks[chunkIdx];
+        auto& vertexMesh = vertexMeshes[chunk.mesh];
+        auto& worker = workers[workerIdx];
+
+        for (auto vertex = chunk.begin; vertex < chunk.end; vertex++) {
+            queueVertex(worker, vertexMesh, chunk.mesh, vertex, options);
+            if (worker.vertexSamples.size() >= streamSize) {
+                traceVertices(worker, scene, samples, vertexMesh, options);
+            }
+        }
+
+        if (!worker.vertexSamples.empty()) {
+            traceVertices(worker, scene, samples, vertexMesh, options);
+        }
+    });
+
+    for (size_t meshIdx = 0; meshIdx < meshes.size(); meshIdx++) {
+        const auto& vertexMesh = vertexMeshes[meshIdx];
+        std::vector<glm::vec4> colors(vertexMesh.occlusion.size());
+        for (size_t i = 0; i < colors.size(); i++) {
+            float ao = vertexMesh.points[i] > 0 ? std::min(1.0f, vertexMesh.occlusion[i] / (float) vertexMesh.points[i]) : 1.0f;
+            colors[i] = {ao, ao, ao, 1.0f};
+        }
+
+        auto& mesh = *meshes[meshIdx];
+        if (mesh.hasVertexAttribute(models::AttributeType::COLOR)) {
+            logging::debug("Ray trace - replacing the vertex colors of mesh {}", mesh.name());
+        }
+        // In the arena of the mesh's geometry, if it has one
+        const auto& arena = mesh.vertexAttribute(models::AttributeType::POSITION).arena();
+        mesh.vertexAttribute(models::AttributeType::COLOR) = models::TypedData::From(models::DataType::FLOAT, 4, colors, arena);
+    }
+
+    auto totals = sumStats(workers);
+    logging::debug("Ray trace - traced {} rays for {} vertex sample points ({} rays per point)",
+                   totals.rays,
+                   totals.texels,
+                   totals.raysPerTexel());
+
+    return Result<BakeStats>{std::make_shared<BakeStats>(totals)};
+}
+
+} // namespace meshtools::ao
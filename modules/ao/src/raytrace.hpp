@@ -1,22 +1,51 @@
 #pragma once
 
+#include <meshtools/ao/ao.hpp>
+#include <meshtools/ao/bake_scene.hpp>
+#include <meshtools/ao/coverage.hpp>
 #include <meshtools/image.hpp>
 #include <meshtools/models/model.hpp>
 #include <meshtools/result.hpp>
 #include <meshtools/size.hpp>
 
+#include <filesystem>
 #include <memory>
 #include <vector>
 
 namespace meshtools::ao {
 
+// Number of covered texels per task of a map bake, in the order of the coverage. Checkpoints keep track of the
+// finished chunks.
+const constexpr size_t TEXEL_CHUNK_SIZE = 4096;
+
 struct RaytraceOptions {
     int nsamples;
     uint8_t resultChannels;
     float far;
     float multiply;
+    size_t threads;
+    size_t streamSize;
+    bool adaptive;
+    int minSamples;
+    int batchSamples;
+    float tolerance;
+    Sampler sampler;
+    float vertexOffset;
+    bool averageTriangles;
+    Region region;
+    bool conservative;
+    uint32_t gutter;
+    std::filesystem::path checkpoint;
+    bool resume;
+    double checkpointInterval;
 };
 
-Result<Image> raytrace(const std::vector<std::shared_ptr<models::Mesh>>& meshes, const Size<uint32_t>& size, RaytraceOptions = {});
+Result<Image> raytrace(const BakeScene& scene, const Size<uint32_t>& size, RaytraceOptions = {}, BakeStats* stats = nullptr);
+
+// Traces the covered texels; the image has the size of the coverage's region, options.region is ignored
+Result<Image> raytrace(const BakeScene& scene, const Coverage& coverage, RaytraceOptions = {}, BakeStats* stats = nullptr);
+
+// Writes the AO per vertex into the COLOR attribute of the meshes
+Result<BakeStats> raytraceVertices(const BakeScene& scene, RaytraceOptions = {});
 
 } // namespace meshtools::ao
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include "sampler.hpp"
+
+#include <meshtools/simd.hpp>
+
+#include <cmath>
+#include <random>
+
+namespace meshtools::ao {
+
+namespace {
+
+// http://www.altdevblogaday.com/2012/05/03/generating-uniformly-distributed-points-on-sphere/
+glm::vec3 random_direction(std::mt19937& rnd) {
+    double z = 2.0f * rnd() / double(std::mt19937::max()) - 1.0;
+    double t = 2.0f * rnd() / double(std::mt19937::max()) * M_PI;
+    double r = sqrt(1.0 - z * z);
+    return {r * cosf(t), r * sinf(t), z};
+}
+
+float radicalInverse(uint32_t base, uint32_t i) {
+    double inverse = 1.0 / base;
+    double factor = inverse;
+    double result = 0;
+    while (i > 0) {
+        result += (i % base) * factor;
+        i /= base;
+        factor *= inverse;
+    }
+    return static_cast<float>(result);
+}
+
+// First two dimensions of the Sobol sequence (Kollig & Keller, "Efficient Multidimensional Sampling")
+float vanDerCorput(uint32_t i) {
+    uint32_t result = 0;
+    for (uint32_t v = 1u << 31; i; i >>= 1, v >>= 1) {
+        if (i & 1) {
+            result ^= v;
+        }
+    }
+    return static_cast<float>(result) * 0x1p-32f;
+}
+
+float sobol2(uint32_t i) {
+    uint32_t result = 0;
+    for (uint32_t v = 1u << 31; i; i >>= 1, v ^= v >> 1) {
+        if (i & 1) {
+            result ^= v;
+        }
+    }
+    return static_cast<float>(result) * 0x1p-32f;
+}
+
+// https://nullprogram.com/blog/2018/07/31/
+uint32_t hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+float unitFloat(uint32_t bits) {
+    // Top 24 bits, so the result is strictly smaller than 1
+    return static_cast<float>(bits >> 8) * 0x1p-24f;
+}
+
+} // namespace
+
+SampleSet::SampleSet(Sampler sampler, size_t count) : sampler(sampler), count(count) {
+    auto padded = (count + simd::WIDTH - 1) / simd::WIDTH * simd::WIDTH + simd::WIDTH;
+    x.resize(padded);
+    y.resize(padded);
+    z.resize(padded);
+
+    if (sampler == Sampler::RANDOM) {
+        std::mt19937 rnd(0);
+        for (size_t i = 0; i < count; i++) {
+            auto dir = random_direction(rnd);
+            x[i] = dir[0];
+            y[i] = dir[1];
+            z[i] = dir[2];
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        float u, v;
+        if (sampler == Sampler::HALTON) {
+            // Skip the first point (0, 0), which is shared by all bases
+            u = radicalInverse(2, i + 1);
+            v = radicalInverse(3, i + 1);
+        } else {
+            u = vanDerCorput(i);
+            v = sobol2(i);
+        }
+        x[i] = u;
+        y[i] = std::cos(2.0f * float(M_PI) * v);
+        z[i] = std::sin(2.0f * float(M_PI) * v);
+    }
+}
+
+Rotation texelRotation(int x, int y) {
+    auto h = hash(static_cast<uint32_t>(x) * 0x9e3779b9U ^ hash(static_cast<uint32_t>(y)));
+    auto angle = 2.0f * float(M_PI) * unitFloat(hash(h));
+    return {unitFloat(h), std::cos(angle), std::sin(angle)};
+}
+
+void emitDirections(
+        const SampleSet& samples, size_t first, size_t count, const glm::vec3& normal, const Rotation& rotation, float* x, float* y, float* z) {
+    const auto normalX = simd::broadcast(normal[0]);
+    const auto normalY = simd::broadcast(normal[1]);
+    const auto normalZ = simd::broadcast(normal[2]);
+    const auto zero = simd::broadcast(0);
+    const auto one = simd::broadcast(1);
+
+    if (samples.sampler == Sampler::RANDOM) {
+        for (size_t i = 0; i < count; i += simd::WIDTH) {
+            auto dirX = simd::load(&samples.x[first + i]);
+            auto dirY = simd::load(&samples.y[first + i]);
+            auto dirZ = simd::load(&samples.z[first + i]);
+
+            // Flip directions into the hemisphere of the normal
+            auto flip = dirX * normalX + dirY * normalY + dirZ * normalZ < zero;
+            simd::store(&x[i], simd::select(flip, -dirX, dirX));
+            simd::store(&y[i], simd::select(flip, -dirY, dirY));
+            simd::store(&z[i], simd::select(flip, -dirZ, dirZ));
+        }
+        return;
+    }
+
+    // Tangent frame (Duff et al., "Building an Orthonormal Basis, Revisited")
+    float sign = std::copysign(1.0f, normal[2]);
+    float a = -1.0f / (sign + normal[2]);
+    float b = normal[0] * normal[1] * a;
+    glm::vec3 tangent{1.0f + sign * normal[0] * normal[0] * a, sign * b, -sign * normal[0]};
+    glm::vec3 bitangent{b, sign + normal[1] * normal[1] * a, -normal[1]};
+
+    const auto tangentX = simd::broadcast(tangent[0]);
+    const auto tangentY = simd::broadcast(tangent[1]);
+    const auto tangentZ = simd::broadcast(tangent[2]);
+    const auto bitangentX = simd::broadcast(bitangent[0]);
+    const auto bitangentY = simd::broadcast(bitangent[1]);
+    const auto bitangentZ = simd::broadcast(bitangent[2]);
+    const auto offset = simd::broadcast(rotation.offset);
+    const auto rotationCos = simd::broadcast(rotation.cos);
+    const auto rotationSin = simd::broadcast(rotation.sin);
+
+    for (size_t i = 0; i < count; i += simd::WIDTH) {
+        // Cranley-Patterson rotation; shifting the second dimension is a rotation around the normal
+        auto u = simd::load(&samples.x[first + i]) + offset;
+        u = simd::select(u >= one, u - one, u);
+        auto phiCos = simd::load(&samples.y[first + i]);
+        auto phiSin = simd::load(&samples.z[first + i]);
+        auto cos = phiCos * rotationCos - phiSin * rotationSin;
+        auto sin = phiSin * rotationCos + phiCos * rotationSin;
+
+        // Cosine-weighted hemisphere
+        auto r = simd::sqrt(u);
+        auto localX = r * cos;
+        auto localY = r * sin;
+        auto localZ = simd::sqrt(one - u);
+
+        simd::store(&x[i], tangentX * localX + bitangentX * localY + normalX * localZ);
+        simd::store(&y[i], tangentY * localX + bitangentY * localY + normalY * localZ);
+        simd::store(&z[i], tangentZ * localX + bitangentZ * localY + normalZ * localZ);
+    }
+}
+
+} // namespace meshtools::ao
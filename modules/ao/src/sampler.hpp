@@ -0,0 +1,41 @@
+#pragma once
+
+#include <meshtools/ao/ao.hpp>
+#include <meshtools/math.hpp>
+
+#include <vector>
+
+namespace meshtools::ao {
+
+// A set of hemisphere samples, shared by all texels of a bake. Stored in SoA layout and padded so a full SIMD
+// load can start at any sample.
+//
+// For Sampler::RANDOM these are uniformly distributed directions on the sphere, which are flipped into the
+// hemisphere of the normal. For the low-discrepancy sequences these are 2D points (u, cos(2*pi*v), sin(2*pi*v))
+// that are cosine-weighted projected into the tangent frame of the normal.
+struct SampleSet {
+    SampleSet(Sampler sampler, size_t count);
+
+    Sampler sampler;
+    size_t count;
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+};
+
+// Per-texel Cranley-Patterson rotation, derived from the texel coordinates only so the result does not depend on
+// the order in which texels are traced.
+struct Rotation {
+    float offset;
+    float cos;
+    float sin;
+};
+
+Rotation texelRotation(int x, int y);
+
+// Writes directions for samples [first, first + count) around the normal. Writes are done in chunks of
+// simd::WIDTH, so up to simd::WIDTH - 1 elements past count are overwritten as well.
+void emitDirections(
+        const SampleSet& samples, size_t first, size_t count, const glm::vec3& normal, const Rotation& rotation, float* x, float* y, float* z);
+
+} // namespace meshtools::ao
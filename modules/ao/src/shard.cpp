@@ -0,0 +1,310 @@
+#include <meshtools/ao/shard.hpp>
+
+#include "hash.hpp"
+
+#include <meshtools/file.hpp>
+#include <meshtools/logging.hpp>
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <optional>
+#include <sstream>
+
+namespace meshtools::ao {
+
+namespace {
+
+// Shards are a multiple of this many rows, to keep the raytracer's tiles filled
+const constexpr uint32_t SHARD_ALIGNMENT = 64;
+
+const constexpr std::array<char, 8> SHARD_MAGIC{'M', 'T', 'A', 'O', 'S', 'H', 'R', 'D'};
+
+struct ShardHeader {
+    std::array<char, 8> magic;
+    // Of the scene and the job the shard was baked for
+    uint64_t hash;
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+};
+
+// Identifies the shards of a job: hashes the scene's geometry, normals, texture coordinates and instances, the map
+// size, the shard count and the options of the job
+uint64_t jobHash(const BakeScene& scene, const ShardJob& job) {
+    Hasher hasher;
+    hasher.add(scene);
+    hasher.add(job.mapSize.width);
+    hasher.add(job.mapSize.height);
+    hasher.add(job.shards);
+    const auto& options = job.options;
+    hasher.add(options.nsamples);
+    hasher.add(options.multiply);
+    hasher.add(options.maxFar);
+    hasher.add(options.channels);
+    hasher.add(options.adaptive);
+    hasher.add(options.minSamples);
+    hasher.add(options.batchSamples);
+    hasher.add(options.tolerance);
+    hasher.add(options.gutter);
+    hasher.add(options.conservative);
+    hasher.add(options.sampler);
+    hasher.add(options.buildQuality);
+    hasher.add(options.compactScene);
+    hasher.add(options.robustScene);
+    return hasher.hash;
+}
+
+const char* samplerName(Sampler sampler) {
+    switch (sampler) {
+        case Sampler::RANDOM:
+            return "random";
+        case Sampler::HALTON:
+            return "halton";
+        case Sampler::SOBOL:
+            return "sobol";
+    }
+    return "random";
+}
+
+std::optional<Sampler> parseSampler(const std::string& name) {
+    for (auto sampler : {Sampler::RANDOM, Sampler::HALTON, Sampler::SOBOL}) {
+        if (name == samplerName(sampler)) {
+            return sampler;
+        }
+    }
+    return std::nullopt;
+}
+
+const char* buildQualityName(BuildQuality quality) {
+    switch (quality) {
+        case BuildQuality::LOW:
+            return "low";
+        case BuildQuality::MEDIUM:
+            return "medium";
+        case BuildQuality::HIGH:
+            return "high";
+    }
+    return "medium";
+}
+
+std::optional<BuildQuality> parseBuildQuality(const std::string& name) {
+    for (auto quality : {BuildQuality::LOW, BuildQuality::MEDIUM, BuildQuality::HIGH}) {
+        if (name == buildQualityName(quality)) {
+            return quality;
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+Result<ShardJob> ShardJob::Load(const std::filesystem::path& file) {
+    std::ifstream in(file);
+    if (!in.is_open()) {
+        return {"Cannot read shard job " + file.string()};
+    }
+
+    Result<ShardJob> result{std::make_shared<ShardJob>()};
+    auto& job = *result.value;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream values(line);
+        std::string key;
+        values >> key;
+        if (key == "model") {
+            std::string model;
+            std::getline(values >> std::ws, model);
+            job.model = file.parent_path() / model;
+        } else if (key == "width") {
+            values >> job.mapSize.width;
+        } else if (key == "height") {
+            values >> job.mapSize.height;
+        } else if (key == "shards") {
+            values >> job.shards;
+        } else if (key == "samples") {
+            values >> job.options.nsamples;
+        } else if (key == "multiply") {
+            values >> job.options.multiply;
+        } else if (key == "far") {
+            values >> job.options.maxFar;
+        } else if (key == "channels") {
+            uint32_t channels = 0;
+            values >> channels;
+            job.options.channels = channels;
+        } else if (key == "adaptive") {
+            values >> job.options.adaptive;
+        } else if (key == "min-samples") {
+            values >> job.options.minSamples;
+        } else if (key == "batch-samples") {
+            values >> job.options.batchSamples;
+        } else if (key == "tolerance") {
+            values >> job.options.tolerance;
+        } else if (key == "gutter") {
+            values >> job.options.gutter;
+        } else if (key == "conservative") {
+            values >> job.options.conservative;
+        } else if (key == "sampler") {
+            std::string name;
+            values >> name;
+            auto sampler = parseSampler(name);
+            if (!sampler) {
+                return {"Unknown sampler in shard job: " + name};
+            }
+            job.options.sampler = *sampler;
+        } else if (key == "build-quality") {
+            std::string name;
+            values >> name;
+            auto quality = parseBuildQuality(name);
+            if (!quality) {
+                return {"Unknown build quality in shard job: " + name};
+            }
+            job.options.buildQuality = *quality;
+        } else if (key == "compact-scene") {
+            values >> job.options.compactScene;
+        } else if (key == "robust-scene") {
+            values >> job.options.robustScene;
+        } else {
+            return {"Unknown key in shard job: " + key};
+        }
+
+        if (values.fail()) {
+            return {"Invalid value in shard job: " + line};
+        }
+    }
+
+    if (job.model.empty() || job.mapSize.width == 0 || job.mapSize.height == 0 || job.shards == 0) {
+        return {"Incomplete shard job " + file.string()};
+    }
+
+    return result;
+}
+
+void ShardJob::save(const std::filesystem::path& file) const {
+    std::ostringstream out;
+    // Floats are written with enough digits to read back the exact same value
+    out << std::setprecision(std::numeric_limits<float>::max_digits10);
+    out << "model " << std::filesystem::relative(model, file.parent_path()).string() << "\n";
+    out << "width " << mapSize.width << "\n";
+    out << "height " << mapSize.height << "\n";
+    out << "shards " << shards << "\n";
+    out << "samples " << options.nsamples << "\n";
+    out << "multiply " << options.multiply << "\n";
+    out << "far " << options.maxFar << "\n";
+    out << "channels " << static_cast<uint32_t>(options.channels) << "\n";
+    out << "adaptive " << options.adaptive << "\n";
+    out << "min-samples " << options.minSamples << "\n";
+    out << "batch-samples " << options.batchSamples << "\n";
+    out << "tolerance " << options.tolerance << "\n";
+    out << "gutter " << options.gutter << "\n";
+    out << "conservative " << options.conservative << "\n";
+    out << "sampler " << samplerName(options.sampler) << "\n";
+    out << "build-quality " << buildQualityName(options.buildQuality) << "\n";
+    out << "compact-scene " << options.compactScene << "\n";
+    out << "robust-scene " << options.robustScene << "\n";
+    file::writeFile(file, out.str());
+}
+
+Region ShardJob::region(uint32_t shard) const {
+    auto rows = (mapSize.height + shards - 1) / shards;
+    rows = (rows + SHARD_ALIGNMENT - 1) / SHARD_ALIGNMENT * SHARD_ALIGNMENT;
+    auto y = std::min(shard * rows, mapSize.height);
+    return {0, y, mapSize.width, std::min(rows, mapSize.height - y)};
+}
+
+std::filesystem::path shardFile(const std::filesystem::path& jobFile, uint32_t shard) {
+    auto path = jobFile;
+    path.replace_filename(jobFile.stem().string() + ".shard-" + std::to_string(shard) + ".bin");
+    return path;
+}
+
+Result<BakeStats> bakeShard(const BakeScene& scene, const ShardJob& job, uint32_t shard, const std::filesystem::path& jobFile,
+                            size_t threads) {
+    if (shard >= job.shards) {
+        return {"Shard " + std::to_string(shard) + " out of range"};
+    }
+
+    auto options = job.options;
+    options.threads = threads;
+    options.region = job.region(shard);
+    if (options.region.empty()) {
+        // More shards than rows, nothing to do
+        logging::debug("Shard {} is empty", shard);
+    }
+
+    // Shards hold the baked texels only; the gutter is filled after the merge, once the other filters have run
+    options.gutter = 0;
+
+    BakeStats stats{};
+    std::shared_ptr<Image> image;
+    if (!options.region.empty()) {
+        auto bakeResult = bake(scene, job.mapSize, options, &stats);
+        if (!bakeResult) {
+            return {std::move(bakeResult.error)};
+        }
+        image = bakeResult.value;
+    }
+
+    // Value initialized, so the padding is written as zeros
+    ShardHeader header{};
+    header.magic = SHARD_MAGIC;
+    header.hash = jobHash(scene, job);
+    header.x = options.region.x;
+    header.y = options.region.y;
+    header.width = options.region.width;
+    header.height = options.region.height;
+    header.channels = options.channels;
+    std::vector<uint8_t> data(sizeof(header));
+    std::memcpy(data.data(), &header, sizeof(header));
+    if (image) {
+        data.insert(data.end(), image->data().begin(), image->data().end());
+    }
+    file::writeFile(shardFile(jobFile, shard), data, true);
+
+    return Result<BakeStats>{std::make_shared<BakeStats>(stats)};
+}
+
+Result<Image> mergeShards(const BakeScene& scene, const ShardJob& job, const std::filesystem::path& jobFile) {
+    const auto hash = jobHash(scene, job);
+    auto image = std::make_shared<Image>(job.mapSize.width, job.mapSize.height, job.options.channels);
+    const size_t rowBytes = static_cast<size_t>(job.mapSize.width) * job.options.channels;
+
+    for (uint32_t shard = 0; shard < job.shards; shard++) {
+        auto path = shardFile(jobFile, shard);
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) {
+            return {"Missing shard " + path.string()};
+        }
+
+        ShardHeader header{};
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!in || header.magic != SHARD_MAGIC) {
+            return {"Invalid shard " + path.string()};
+        }
+        if (header.hash != hash) {
+            return {"Shard " + path.string() + " was baked for another model, job or options"};
+        }
+        const auto region = job.region(shard);
+        if (header.x != region.x || header.y != region.y || header.width != region.width ||
+            header.height != region.height || header.channels != job.options.channels) {
+            return {"Shard " + path.string() + " does not match the job"};
+        }
+
+        in.read(reinterpret_cast<char*>(image->data().data() + region.y * rowBytes), region.height * rowBytes);
+        if (!in) {
+            return {"Truncated shard " + path.string()};
+        }
+    }
+
+    return Result<Image>{std::move(image)};
+}
+
+} // namespace meshtools::ao
@@ -0,0 +1,55 @@
+#include "tiled.hpp"
+
+#include <meshtools/ao/coverage.hpp>
+
+#include <algorithm>
+
+namespace meshtools::ao {
+
+namespace {
+
+// Bands are a multiple of this many rows (when the budget allows it), to keep the raytracer's tiles filled
+const constexpr uint32_t BAND_ALIGNMENT = 64;
+
+} // namespace
+
+size_t bandTexelBytes(uint8_t channels, const FilterOptions& options) {
+    // The alpha channel isn't filtered
+    const size_t colors = channels == 4 ? 3 : channels;
+
+    // Denoise: the guides, and the queue of the chart search (Coverage::guides) or the value planes of the passes
+    size_t filter = 0;
+    if (options.denoise > 0) {
+        filter = 2 * sizeof(glm::vec3) + sizeof(uint32_t) + std::max(sizeof(size_t), 2 * colors * sizeof(float));
+    }
+    // Blur: the mask and the horizontal pass, the summed weights and every color channel
+    if (options.blurKernelSize > 0) {
+        filter = std::max(filter, 1 + (colors + 1) * sizeof(float));
+    }
+    // Gutter: the mask and the two seed buffers of the jump flood
+    if (options.gutter > 0) {
+        filter = std::max(filter, 1 + 2 * sizeof(int32_t));
+    }
+    // The compressed rows, which are collected per thread and then appended to the output
+    const size_t compression = 2 * (static_cast<size_t>(channels) + 1);
+
+    // Coverage::Create holds the texels of its tiles and the merged ones at once, the image doesn't exist yet then
+    return sizeof(CoverageTexel) + std::max(sizeof(CoverageTexel), channels + std::max(filter, compression));
+}
+
+uint32_t bandHeight(size_t memoryBudget, uint32_t width, uint32_t height, uint8_t channels, const FilterOptions& options) {
+    const size_t halo = options.reach();
+    const size_t rowBytes = static_cast<size_t>(width) * bandTexelBytes(channels, options);
+    const size_t budgetRows = memoryBudget / rowBytes;
+    if (budgetRows <= 2 * halo) {
+        return 0;
+    }
+
+    auto rows = static_cast<uint32_t>(std::min<size_t>(budgetRows - 2 * halo, height));
+    if (rows > BAND_ALIGNMENT) {
+        rows -= rows % BAND_ALIGNMENT;
+    }
+    return rows;
+}
+
+} // namespace meshtools::ao
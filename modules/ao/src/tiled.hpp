@@ -0,0 +1,18 @@
+#pragma once
+
+#include <meshtools/ao/ao.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace meshtools::ao {
+
+// Bytes per texel of a band at the peak of its bake: the coverage, the image, and the largest of the filter and PNG
+// compression buffers that exist next to them
+size_t bandTexelBytes(uint8_t channels, const FilterOptions& options);
+
+// Rows per band of a tiled bake of a region of width x height, such that a band with its halos of
+// options.reach() rows on both sides fits into the budget. 0 if not even a single row fits.
+uint32_t bandHeight(size_t memoryBudget, uint32_t width, uint32_t height, uint8_t channels, const FilterOptions& options);
+
+} // namespace meshtools::ao
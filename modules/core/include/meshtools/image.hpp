@@ -1,17 +1,47 @@
 #pragma once
 
+#include <meshtools/math.hpp>
+#include <meshtools/result.hpp>
+
 #include <filesystem>
+#include <string>
 #include <vector>
 
 namespace meshtools {
 
+// Per texel surface information for Image::denoise, in the texel order of the image. Texels with chart 0 are
+// empty; they are neither changed nor used.
+struct DenoiseGuides {
+    // In world space
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<uint32_t> charts;
+};
+
+struct DenoiseOptions {
+    // Passes of the filter; pass i takes the texels 2^i apart, so 4 passes reach 30 texels
+    uint32_t iterations = 4;
+    // Falloff of the weights with the difference of the values (0..1), halved with every pass
+    float valueSigma = 0.25f;
+    // Falloff with the distance from the texel's tangent plane, in texels of the pass
+    float planeSigma = 1.0f;
+    // Exponent of the cosine between the normals
+    float normalPower = 32.0f;
+    size_t threads = 0;
+};
+
+// The pixels of an image, or its encoded file (PNG, JPG or KTX2) which is only decoded when the pixels are needed. The
+// pixel operations (blur, denoise, dilate and encoding) need a RAW image.
 struct Image {
-    enum class Type { RAW, PNG, JPG };
+    enum class Type { RAW, PNG, JPG, KTX2 };
 
     Image(uint32_t width, uint32_t height, uint8_t channels);
 
     Image(uint32_t width, uint32_t height, uint8_t channels, Type, std::vector<uint8_t> data);
 
+    // Keeps the encoded file as it is; the type, size and channels are read from its header
+    static Result<Image> Encoded(std::vector<uint8_t> data);
+
     ~Image() = default;
 
     uint32_t width() const {
@@ -46,13 +76,40 @@ struct Image {
         return type_;
     }
 
-    void blur(uint8_t blurKernelSize = 5);
+    // "image/png", "image/jpeg" or "image/ktx2", empty for RAW images
+    std::string mimeType() const;
+
+    // The pixels of a PNG or JPG image, RAW images are copied
+    Result<Image> decode() const;
 
-    Image png() const;
+    // Gaussian blur of the texels that are set (non-zero first channel), which also spreads them into empty texels
+    // up to the kernel size away. Runs as separate row and column passes on up to `threads` threads.
+    void blur(uint8_t blurKernelSize = 5, size_t threads = 0);
+
+    // Only blurs the texels inside the mask (one channel, non-zero is inside), and only with each other, so the
+    // background doesn't bleed into the charts
+    void blur(const Image& mask, uint8_t blurKernelSize = 5, size_t threads = 0);
+
+    // Edge-avoiding a-trous wavelet filter: smooths the noise of low sample bakes while keeping chart borders,
+    // creases and contact edges sharp, which are found from the guides
+    void denoise(const DenoiseGuides& guides, const DenoiseOptions& options = {});
+
+    // Fills the texels outside of the mask (one channel, non-zero is inside) that are at most `gutter` texels away
+    // from it with the nearest texel inside. Uses jump flooding, so it takes O(n log gutter) whatever the gutter.
+    void dilate(const Image& mask, uint32_t gutter, size_t threads = 0);
+
+    // Compresses bands of rows in parallel on up to `threads` threads (0 = all)
+    Image png(size_t threads = 0) const;
 
     Image jpg(uint8_t quality = 50) const;
 
+    // GPU compressed texture with a full mip chain: BC4 for images with one channel, BC5 for two. The 4x4 blocks are
+    // compressed on up to `threads` threads.
+    Image ktx2(size_t threads = 0) const;
+
 private:
+    void blur(const Image* mask, uint8_t blurKernelSize, size_t threads);
+
     std::string name_;
     uint32_t width_;
     uint32_t height_;
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace meshtools::parallel {
+
+// Number of hardware threads available, at least 1
+size_t concurrency();
+
+// Resolves a requested thread count; 0 means "use all hardware threads"
+inline size_t threads(size_t requested) {
+    return requested > 0 ? requested : concurrency();
+}
+
+// Runs fn(task, worker) for every task in [0, taskCount) on up to `threads` workers (0 = all hardware threads).
+// Every worker starts out with an even, contiguous share of the tasks and takes them from the front; a worker
+// that runs dry steals the back half of the largest remaining share. The worker index is stable for the duration
+// of a task, so it can be used to address per-worker scratch state. The first exception thrown by a task is
+// re-thrown on the calling thread once all workers have finished.
+void forEach(size_t taskCount, size_t threads, const std::function<void(size_t task, size_t worker)>& fn);
+
+} // namespace meshtools::parallel
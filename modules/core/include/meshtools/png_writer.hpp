@@ -0,0 +1,37 @@
+#pragma once
+
+#include <meshtools/result.hpp>
+
+#include <filesystem>
+#include <memory>
+
+namespace meshtools {
+
+// Writes an 8-bit PNG file row by row, for images that are too large to keep in memory. Rows are compressed as they
+// come in, in parallel bands when many rows are written at once; only the last row is kept around.
+class PngWriter {
+public:
+    PngWriter();
+    ~PngWriter();
+
+    static Result<PngWriter> Open(const std::filesystem::path& path, uint32_t width, uint32_t height, uint8_t channels);
+
+    uint32_t width() const;
+    uint32_t height() const;
+    uint8_t channels() const;
+
+    // Number of rows written so far
+    uint32_t rows() const;
+
+    // Appends `count` rows of width * channels bytes each, compressed on up to `threads` threads (0 = all)
+    void write(const uint8_t* data, uint32_t count, size_t threads = 0);
+
+    // Completes the file; returns false if not all rows were written or the file could not be written
+    bool finish();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace meshtools
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Compiles a function for several x86 instruction sets; the best one the CPU supports is picked when the program is
+// loaded. Needs ifunc support (ELF), elsewhere there is only the generic build.
+#if defined(__x86_64__) && defined(__ELF__) && (defined(__GNUC__) || defined(__clang__))
+#define MESHTOOLS_TARGET_CLONES __attribute__((target_clones("avx2", "sse4.1", "default")))
+#else
+#define MESHTOOLS_TARGET_CLONES
+#endif
+
+// Portable fixed width vectors on top of the GCC/Clang vector extensions. These lower to SSE/AVX on x86 and
+// NEON on ARM, and to scalar code anywhere else.
+namespace meshtools::simd {
+
+const constexpr size_t WIDTH = 8;
+
+using f32x8 = float __attribute__((vector_size(WIDTH * sizeof(float))));
+using i32x8 = int32_t __attribute__((vector_size(WIDTH * sizeof(int32_t))));
+
+inline f32x8 load(const float* src) {
+    f32x8 result;
+    std::memcpy(&result, src, sizeof(result));
+    return result;
+}
+
+inline void store(float* dst, const f32x8& value) {
+    std::memcpy(dst, &value, sizeof(value));
+}
+
+inline f32x8 broadcast(float value) {
+    return f32x8{} + value;
+}
+
+// Lane-wise mask ? a : b, where mask is the result of a vector comparison (all bits set / clear per lane)
+inline f32x8 select(const i32x8& mask, const f32x8& a, const f32x8& b) {
+    return (f32x8) (((i32x8) a & mask) | ((i32x8) b & ~mask));
+}
+
+inline f32x8 sqrt(const f32x8& value) {
+    f32x8 result;
+    for (size_t i = 0; i < WIDTH; i++) {
+        result[i] = std::sqrt(value[i]);
+    }
+    return result;
+}
+
+} // namespace meshtools::simd
@@ -0,0 +1,80 @@
+#include "bc.hpp"
+
+#include <meshtools/parallel.hpp>
+#include <meshtools/simd.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace meshtools::detail {
+
+namespace {
+
+const constexpr size_t BLOCK_TEXELS = 16;
+
+} // namespace
+
+void compressBc4Block(const uint8_t* texels, uint8_t* out) {
+    using simd::f32x8;
+    using simd::i32x8;
+    static_assert(BLOCK_TEXELS == 2 * simd::WIDTH);
+
+    const auto [lo, hi] = std::minmax_element(texels, texels + BLOCK_TEXELS);
+    // The 8 value mode: index 0 and 1 are the endpoints, 2 to 7 are evenly spaced from red0 to red1
+    out[0] = *hi;
+    out[1] = *lo;
+
+    uint64_t indices = 0;
+    if (*hi > *lo) {
+        const auto scale = simd::broadcast(7.0f / static_cast<float>(*hi - *lo));
+        const auto offset = simd::broadcast(static_cast<float>(*lo));
+        for (size_t half = 0; half < 2; half++) {
+            i32x8 values;
+            for (size_t i = 0; i < simd::WIDTH; i++) {
+                values[i] = texels[half * simd::WIDTH + i];
+            }
+
+            // The nearest of the evenly spaced values, counted from red0
+            const auto steps = __builtin_convertvector((__builtin_convertvector(values, f32x8) - offset) * scale + 0.5f, i32x8);
+            const i32x8 fromHi = 7 - steps;
+            const i32x8 isHi = fromHi == 0;
+            const i32x8 isLo = fromHi == 7;
+            const i32x8 index = ((fromHi + 1) & ~(isHi | isLo)) | (1 & isLo);
+            for (size_t i = 0; i < simd::WIDTH; i++) {
+                indices |= static_cast<uint64_t>(index[i]) << (3 * (half * simd::WIDTH + i));
+            }
+        }
+    }
+
+    for (size_t i = 0; i < 6; i++) {
+        out[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+    }
+}
+
+std::vector<uint8_t> compressBc(const uint8_t* data, uint32_t width, uint32_t height, uint8_t channels, size_t threads) {
+    assert(channels == 1 || channels == 2);
+
+    const size_t blocksX = (width + 3) / 4;
+    const size_t blocksY = (height + 3) / 4;
+    const size_t blockBytes = BC4_BLOCK_BYTES * channels;
+    std::vector<uint8_t> result(blocksX * blocksY * blockBytes);
+
+    parallel::forEach(blocksY, threads, [&](size_t blockY, size_t) {
+        uint8_t texels[BLOCK_TEXELS];
+        for (size_t blockX = 0; blockX < blocksX; blockX++) {
+            auto* out = &result[(blockY * blocksX + blockX) * blockBytes];
+            for (uint8_t channel = 0; channel < channels; channel++) {
+                for (size_t i = 0; i < BLOCK_TEXELS; i++) {
+                    const auto x = std::min<size_t>(blockX * 4 + i % 4, width - 1);
+                    const auto y = std::min<size_t>(blockY * 4 + i / 4, height - 1);
+                    texels[i] = data[(y * width + x) * channels + channel];
+                }
+                compressBc4Block(texels, out + channel * BC4_BLOCK_BYTES);
+            }
+        }
+    });
+
+    return result;
+}
+
+} // namespace meshtools::detail
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace meshtools::detail {
+
+// Bytes per 4x4 block of a BC4 channel
+const constexpr size_t BC4_BLOCK_BYTES = 8;
+
+// Compresses a 4x4 block of one channel (row by row) to BC4
+void compressBc4Block(const uint8_t* texels, uint8_t* out);
+
+// Compresses an image with one channel to BC4 or with two channels to BC5 (a BC4 block per channel), in rows of 4x4
+// blocks. Blocks at the right and bottom edges of sizes that aren't a multiple of 4 repeat the last texel. Block rows
+// are compressed on up to `threads` threads.
+std::vector<uint8_t> compressBc(const uint8_t* data, uint32_t width, uint32_t height, uint8_t channels, size_t threads);
+
+} // namespace meshtools::detail
@@ -0,0 +1,235 @@
+#include "deflate.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+namespace meshtools::detail {
+
+namespace {
+
+const constexpr size_t WINDOW_SIZE = 32768;
+const constexpr size_t HASH_BITS = 15;
+const constexpr size_t MIN_MATCH = 3;
+const constexpr size_t MAX_MATCH = 258;
+// Number of earlier positions that are tried per match; more compresses better, but slower
+const constexpr size_t MAX_CHAIN = 32;
+
+const constexpr std::array<uint16_t, 29> LENGTH_BASE{3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                                     31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const constexpr std::array<uint8_t, 29> LENGTH_EXTRA{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const constexpr std::array<uint16_t, 30> DISTANCE_BASE{1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                                       193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const constexpr std::array<uint8_t, 30> DISTANCE_EXTRA{0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+std::array<uint32_t, 256> crcTable() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        table[n] = c;
+    }
+    return table;
+}
+
+} // namespace
+
+uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size) {
+    static const auto table = crcTable();
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t adler32(uint32_t adler, const uint8_t* data, size_t size) {
+    const uint32_t MOD = 65521;
+    uint32_t a = adler & 0xffff;
+    uint32_t b = adler >> 16;
+    while (size > 0) {
+        // Largest block that can't overflow before the modulo
+        size_t block = std::min<size_t>(size, 5552);
+        for (size_t i = 0; i < block; i++) {
+            a += data[i];
+            b += a;
+        }
+        a %= MOD;
+        b %= MOD;
+        data += block;
+        size -= block;
+    }
+    return (b << 16) | a;
+}
+
+uint32_t adler32Combine(uint32_t adler1, uint32_t adler2, size_t size2) {
+    const uint64_t MOD = 65521;
+    const uint64_t remainder = size2 % MOD;
+    uint64_t a = (adler1 & 0xffff) + (adler2 & 0xffff) + MOD - 1;
+    uint64_t b = (remainder * (adler1 & 0xffff)) % MOD + (adler1 >> 16) + (adler2 >> 16) + MOD - remainder;
+    a %= MOD;
+    b %= MOD;
+    return static_cast<uint32_t>((b << 16) | a);
+}
+
+Deflater::Deflater() : head_(size_t{1} << HASH_BITS, 0), prev_(WINDOW_SIZE, 0) {}
+
+void Deflater::writeBits(uint32_t bits, uint32_t count, std::vector<uint8_t>& out) {
+    bitBuffer_ |= static_cast<uint64_t>(bits) << bitCount_;
+    bitCount_ += count;
+    while (bitCount_ >= 8) {
+        out.push_back(static_cast<uint8_t>(bitBuffer_));
+        bitBuffer_ >>= 8;
+        bitCount_ -= 8;
+    }
+}
+
+void Deflater::writeCode(uint32_t code, uint32_t length, std::vector<uint8_t>& out) {
+    uint32_t reversed = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        reversed |= ((code >> i) & 1) << (length - 1 - i);
+    }
+    writeBits(reversed, length, out);
+}
+
+void Deflater::writeLiteral(uint32_t literal, std::vector<uint8_t>& out) {
+    // The fixed literal/length code (RFC 1951, 3.2.6)
+    if (literal < 144) {
+        writeCode(0x30 + literal, 8, out);
+    } else if (literal < 256) {
+        writeCode(0x190 + literal - 144, 9, out);
+    } else if (literal < 280) {
+        writeCode(literal - 256, 7, out);
+    } else {
+        writeCode(0xc0 + literal - 280, 8, out);
+    }
+}
+
+void Deflater::writeMatch(uint32_t length, uint32_t distance, std::vector<uint8_t>& out) {
+    assert(length >= MIN_MATCH && length <= MAX_MATCH);
+    assert(distance >= 1 && distance <= WINDOW_SIZE);
+
+    auto lengthCode = std::upper_bound(LENGTH_BASE.begin(), LENGTH_BASE.end(), length) - LENGTH_BASE.begin() - 1;
+    writeLiteral(257 + lengthCode, out);
+    writeBits(length - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode], out);
+
+    auto distanceCode = std::upper_bound(DISTANCE_BASE.begin(), DISTANCE_BASE.end(), distance) - DISTANCE_BASE.begin() - 1;
+    writeCode(distanceCode, 5, out);
+    writeBits(distance - DISTANCE_BASE[distanceCode], DISTANCE_EXTRA[distanceCode], out);
+}
+
+uint32_t Deflater::hash(size_t pos) const {
+    const auto* p = &window_[pos - base_];
+    return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & ((1u << HASH_BITS) - 1);
+}
+
+void Deflater::insert(size_t pos) {
+    auto& head = head_[hash(pos)];
+    prev_[pos % WINDOW_SIZE] = head;
+    head = pos + 1;
+}
+
+void Deflater::compress(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    if (!blockOpen_) {
+        blockOpen_ = true;
+        // Header of a (not final) fixed Huffman block
+        writeBits(0b010, 3, out);
+    }
+
+    auto pos = base_ + window_.size();
+    window_.insert(window_.end(), data, data + size);
+    const auto end = base_ + window_.size();
+
+    while (pos < end) {
+        size_t bestLength = 0;
+        size_t bestDistance = 0;
+
+        if (end - pos >= MIN_MATCH) {
+            const auto maxLength = std::min(MAX_MATCH, end - pos);
+            const auto* current = &window_[pos - base_];
+
+            auto candidate = head_[hash(pos)];
+            for (size_t chain = 0; chain < MAX_CHAIN && candidate > 0; chain++) {
+                auto match = candidate - 1;
+                if (match >= pos || pos - match > WINDOW_SIZE || match < base_) {
+                    break;
+                }
+
+                const auto* previous = &window_[match - base_];
+                size_t length = 0;
+                while (length < maxLength && previous[length] == current[length]) {
+                    length++;
+                }
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestDistance = pos - match;
+                    if (length == maxLength) {
+                        break;
+                    }
+                }
+
+                auto next = prev_[match % WINDOW_SIZE];
+                if (next >= candidate) {
+                    break; // Overwritten by a newer position
+                }
+                candidate = next;
+            }
+        }
+
+        if (bestLength >= MIN_MATCH) {
+            writeMatch(bestLength, bestDistance, out);
+            for (size_t i = 0; i < bestLength; i++, pos++) {
+                if (end - pos >= MIN_MATCH) {
+                    insert(pos);
+                }
+            }
+        } else {
+            writeLiteral(window_[pos - base_], out);
+            if (end - pos >= MIN_MATCH) {
+                insert(pos);
+            }
+            pos++;
+        }
+    }
+
+    // Only the last window of input is needed to find matches
+    if (window_.size() > 2 * WINDOW_SIZE) {
+        auto drop = window_.size() - WINDOW_SIZE;
+        window_.erase(window_.begin(), window_.begin() + drop);
+        base_ += drop;
+    }
+}
+
+void Deflater::flush(std::vector<uint8_t>& out) {
+    if (blockOpen_) {
+        writeLiteral(256, out);
+        blockOpen_ = false;
+    }
+
+    // An empty stored block, which is byte aligned
+    writeBits(0b000, 3, out);
+    if (bitCount_ > 0) {
+        writeBits(0, 8 - bitCount_, out);
+    }
+    for (auto byte : {0x00, 0x00, 0xff, 0xff}) {
+        out.push_back(static_cast<uint8_t>(byte));
+    }
+}
+
+void Deflater::finish(std::vector<uint8_t>& out) {
+    if (blockOpen_) {
+        writeLiteral(256, out);
+        blockOpen_ = false;
+    }
+
+    // A final empty block
+    writeBits(0b011, 3, out);
+    writeLiteral(256, out);
+    if (bitCount_ > 0) {
+        writeBits(0, 8 - bitCount_, out);
+    }
+}
+
+} // namespace meshtools::detail
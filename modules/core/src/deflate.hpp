@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace meshtools::detail {
+
+// Incremental checksums of the zlib and PNG formats
+uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size);
+uint32_t adler32(uint32_t adler, const uint8_t* data, size_t size);
+
+// The adler32 of two pieces of data from the adler32s of the pieces, where the second one is `size2` bytes long
+uint32_t adler32Combine(uint32_t adler1, uint32_t adler2, size_t size2);
+
+// The zlib header for a 32k window, and the final (empty) deflate block
+const constexpr uint8_t ZLIB_HEADER[2] = {0x78, 0x01};
+const constexpr uint8_t DEFLATE_END[2] = {0x03, 0x00};
+
+// A streaming raw deflate compressor. Input can be fed in any number of pieces, matches are found across pieces
+// within the usual 32k window. Uses the fixed Huffman codes, which keeps it simple and works well enough for the
+// smooth images it is used for.
+//
+// Flushed output ends on a byte boundary with no final block, so pieces that are compressed independently (in
+// parallel) can be concatenated into one stream, followed by DEFLATE_END.
+class Deflater {
+public:
+    Deflater();
+
+    // Compresses the input and appends the output to `out`
+    void compress(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+
+    // Completes the output so far up to a byte boundary (a zlib sync flush)
+    void flush(std::vector<uint8_t>& out);
+
+    // Ends the stream with a final block
+    void finish(std::vector<uint8_t>& out);
+
+private:
+    void writeBits(uint32_t bits, uint32_t count, std::vector<uint8_t>& out);
+    // Huffman codes are written starting at their most significant bit
+    void writeCode(uint32_t code, uint32_t length, std::vector<uint8_t>& out);
+    void writeLiteral(uint32_t literal, std::vector<uint8_t>& out);
+    void writeMatch(uint32_t length, uint32_t distance, std::vector<uint8_t>& out);
+
+    uint32_t hash(size_t pos) const;
+    void insert(size_t pos);
+
+    // Whether a fixed Huffman block was started
+    bool blockOpen_ = false;
+    uint64_t bitBuffer_ = 0;
+    uint32_t bitCount_ = 0;
+
+    // Input that is still in the window; window_[0] is at position base_ of the stream
+    std::vector<uint8_t> window_;
+    size_t base_ = 0;
+    // Most recent stream position per hash (+1, 0 is empty) and the previous one with the same hash per position
+    std::vector<size_t> head_;
+    std::vector<size_t> prev_;
+};
+
+} // namespace meshtools::detail
@@ -2,17 +2,140 @@
 
 #include <meshtools/file.hpp>
 #include <meshtools/logging.hpp>
+#include <meshtools/parallel.hpp>
+#include <meshtools/simd.hpp>
+
+#include "bc.hpp"
+#include "deflate.hpp"
+#include "ktx2.hpp"
+#include "png.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image.h>
 #include <stb_image_write.h>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
+#include <limits>
 
 namespace meshtools {
 
+namespace {
+
+// Rows per task of the parallel image passes
+const constexpr uint32_t ROWS_PER_TASK = 16;
+
+const constexpr int32_t NO_SEED = -1;
+
+// Gaussian blur taps for offsets 0..radius; the constant factor is left out since blurs normalize by the summed weights
+std::vector<float> blurKernel(int radius) {
+    const float sigma = 4.0f;
+    std::vector<float> kernel(radius + 1);
+    for (int i = 0; i <= radius; i++) {
+        kernel[i] = std::exp(-static_cast<float>(i * i) / (2.0f * sigma * sigma));
+    }
+    return kernel;
+}
+
+// B3 spline taps of the a-trous filter, for offsets -2..2
+const constexpr std::array<float, 5> ATROUS_KERNEL{1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+
+// Average distance between horizontally adjacent texels of the same chart in world space
+float texelSize(const DenoiseGuides& guides, size_t width) {
+    double total = 0.0;
+    size_t count = 0;
+    for (size_t i = 0; i + 1 < guides.charts.size(); i++) {
+        if (guides.charts[i] != 0 && (i + 1) % width != 0 && guides.charts[i] == guides.charts[i + 1]) {
+            total += glm::length(guides.positions[i + 1] - guides.positions[i]);
+            count++;
+        }
+    }
+    return count > 0 && total > 0.0 ? static_cast<float>(total / count) : 1.0f;
+}
+
+// dst[i] += weight * src[i] for i in [0, count)
+void accumulate(float* dst, const float* src, float weight, size_t count) {
+    const auto weights = simd::broadcast(weight);
+    size_t i = 0;
+    for (; i + simd::WIDTH <= count; i += simd::WIDTH) {
+        simd::store(dst + i, simd::load(dst + i) + weights * simd::load(src + i));
+    }
+    for (; i < count; i++) {
+        dst[i] += weight * src[i];
+    }
+}
+
+// One jump flooding pass: every texel takes the nearest of the seeds of its 3x3 neighbours at `step` texels
+void jumpFlood(const std::vector<int32_t>& seeds, std::vector<int32_t>& next, int width, int height, int step, size_t threads) {
+    auto distance = [width](int x, int y, int32_t seed) {
+        int64_t dx = seed % width - x;
+        int64_t dy = seed / width - y;
+        return dx * dx + dy * dy;
+    };
+
+    const auto tasks = (height + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    parallel::forEach(tasks, threads, [&](size_t task, size_t) {
+        const int endY = std::min<int>(height, (task + 1) * ROWS_PER_TASK);
+        for (int y = task * ROWS_PER_TASK; y < endY; y++) {
+            for (int x = 0; x < width; x++) {
+                auto best = seeds[y * width + x];
+                auto bestDistance = best == NO_SEED ? std::numeric_limits<int64_t>::max() : distance(x, y, best);
+                for (int sy = y - step; sy <= y + step; sy += step) {
+                    if (sy < 0 || sy >= height) {
+                        continue;
+                    }
+                    for (int sx = x - step; sx <= x + step; sx += step) {
+                        if (sx < 0 || sx >= width) {
+                            continue;
+                        }
+                        auto seed = seeds[sy * width + sx];
+                        if (seed == NO_SEED) {
+                            continue;
+                        }
+                        auto d = distance(x, y, seed);
+                        if (d < bestDistance) {
+                            best = seed;
+                            bestDistance = d;
+                        }
+                    }
+                }
+                next[y * width + x] = best;
+            }
+        }
+    });
+}
+
+// Half the size (rounded down, at least 1), each texel the average of the 2x2 texels it covers
+std::vector<uint8_t> halve(const std::vector<uint8_t>& data, uint32_t width, uint32_t height, uint8_t channels, size_t threads) {
+    const uint32_t halfWidth = std::max(1u, width / 2);
+    const uint32_t halfHeight = std::max(1u, height / 2);
+    std::vector<uint8_t> result(static_cast<size_t>(halfWidth) * halfHeight * channels);
+
+    parallel::forEach((halfHeight + ROWS_PER_TASK - 1) / ROWS_PER_TASK, threads, [&](size_t task, size_t) {
+        const uint32_t endY = std::min<uint32_t>(halfHeight, (task + 1) * ROWS_PER_TASK);
+        for (uint32_t y = task * ROWS_PER_TASK; y < endY; y++) {
+            const size_t y0 = std::min(2 * y, height - 1);
+            const size_t y1 = std::min(2 * y + 1, height - 1);
+            for (uint32_t x = 0; x < halfWidth; x++) {
+                const size_t x0 = std::min(2 * x, width - 1);
+                const size_t x1 = std::min(2 * x + 1, width - 1);
+                for (uint8_t c = 0; c < channels; c++) {
+                    const uint32_t sum = data[(y0 * width + x0) * channels + c] + data[(y0 * width + x1) * channels + c] +
+                                         data[(y1 * width + x0) * channels + c] + data[(y1 * width + x1) * channels + c];
+                    result[(static_cast<size_t>(y) * halfWidth + x) * channels + c] = static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+    });
+
+    return result;
+}
+
+} // namespace
+
 Image::Image(uint32_t width, uint32_t height, uint8_t channels) : width_(width), height_(height), channels_(channels), type_(Type::RAW) {
     assert(width_ > 0);
     assert(height_ > 0);
@@ -27,24 +150,86 @@ Image::Image(uint32_t width, uint32_t height, uint8_t channels, Type type, std::
     assert(channels_ > 0);
 }
 
-Image Image::png() const {
-    std::vector<unsigned char> result{};
-    result.reserve(data_.size()); // conservative
-    stbi_write_png_to_func(
-            [](void* context, void* data, int size) {
-                auto out = (std::vector<unsigned char>*) context;
-                std::copy_n((unsigned char*) data, size, std::back_inserter(*out));
-            },
-            &result,
-            width(),
-            height(),
-            channels(),
-            data().data(),
-            width() * channels());
+Result<Image> Image::Encoded(std::vector<uint8_t> data) {
+    const uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    const uint8_t JPG_SIGNATURE[3] = {0xff, 0xd8, 0xff};
+
+    Type type;
+    uint32_t ktx2Width, ktx2Height, vkFormat;
+    if (detail::ktx2Info(data.data(), data.size(), ktx2Width, ktx2Height, vkFormat)) {
+        if (vkFormat != detail::VK_FORMAT_BC4_UNORM_BLOCK && vkFormat != detail::VK_FORMAT_BC5_UNORM_BLOCK) {
+            return {"Unsupported KTX2 format " + std::to_string(vkFormat)};
+        }
+        const uint8_t channels = vkFormat == detail::VK_FORMAT_BC5_UNORM_BLOCK ? 2 : 1;
+        return {std::make_shared<Image>(ktx2Width, ktx2Height, channels, Type::KTX2, std::move(data))};
+    } else if (data.size() >= sizeof(PNG_SIGNATURE) && std::equal(PNG_SIGNATURE, PNG_SIGNATURE + sizeof(PNG_SIGNATURE), data.begin())) {
+        type = Type::PNG;
+    } else if (data.size() >= sizeof(JPG_SIGNATURE) && std::equal(JPG_SIGNATURE, JPG_SIGNATURE + sizeof(JPG_SIGNATURE), data.begin())) {
+        type = Type::JPG;
+    } else {
+        return {"Unsupported image format, expected PNG, JPG or KTX2"};
+    }
+
+    int width, height, channels;
+    if (!stbi_info_from_memory(data.data(), static_cast<int>(data.size()), &width, &height, &channels)) {
+        return {std::string{"Invalid image: "} + stbi_failure_reason()};
+    }
+
+    return {std::make_shared<Image>(width, height, channels, type, std::move(data))};
+}
+
+std::string Image::mimeType() const {
+    switch (type_) {
+        case Type::PNG:
+            return "image/png";
+        case Type::JPG:
+            return "image/jpeg";
+        case Type::KTX2:
+            return "image/ktx2";
+        default:
+            return {};
+    }
+}
+
+Result<Image> Image::decode() const {
+    if (type_ == Type::RAW) {
+        return {std::make_shared<Image>(*this)};
+    }
+    if (type_ == Type::KTX2) {
+        return {"Decoding KTX2 images is not supported"};
+    }
+
+    int width, height, channels;
+    auto* pixels = stbi_load_from_memory(data_.data(), static_cast<int>(data_.size()), &width, &height, &channels, 0);
+    if (!pixels) {
+        return {"Failed to decode image " + name_ + ": " + stbi_failure_reason()};
+    }
+
+    auto image = std::make_shared<Image>(width, height, channels, Type::RAW, std::vector<uint8_t>(pixels, pixels + width * height * channels));
+    image->name_ = name_;
+    stbi_image_free(pixels);
+    return {std::move(image)};
+}
+
+Image Image::png(size_t threads) const {
+    assert(type_ == Type::RAW);
+    std::vector<uint8_t> compressed(detail::ZLIB_HEADER, detail::ZLIB_HEADER + 2);
+    uint32_t adler = 1;
+    detail::compressRows(data_.data(), height_, nullptr, width_, channels_, threads, compressed, adler);
+    compressed.insert(compressed.end(), detail::DEFLATE_END, detail::DEFLATE_END + 2);
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        compressed.push_back(static_cast<uint8_t>(adler >> shift));
+    }
+
+    auto result = detail::pngHeader(width_, height_, channels_);
+    result.reserve(result.size() + compressed.size() + 24);
+    detail::appendPngChunk(result, "IDAT", compressed.data(), compressed.size());
+    detail::appendPngChunk(result, "IEND", nullptr, 0);
     return Image{width_, height_, channels_, Type::PNG, std::move(result)};
 }
 
 Image Image::jpg(uint8_t quality) const {
+    assert(type_ == Type::RAW);
     std::vector<unsigned char> result{};
     result.reserve(data_.size()); // conservative
     stbi_write_jpg_to_func(
@@ -61,44 +246,270 @@ Image Image::jpg(uint8_t quality) const {
     return Image{width_, height_, channels_, Type::JPG, std::move(result)};
 }
 
-void Image::blur(uint8_t blurKernelSize) {
-    // Do bilateral blur pass
-    for (int y = 0; y < height(); y++) {
-        for (int x = 0; x < width(); x++) {
-            auto srcIdx = y * width() + x;
+Image Image::ktx2(size_t threads) const {
+    assert(type_ == Type::RAW);
+    assert(channels_ == 1 || channels_ == 2);
 
-            double sum = 0.0;
-            const double sigma = 4.0;
-            size_t minIdx = 0;
-            size_t maxIdx = data_.size() - 1;
+    std::vector<std::vector<uint8_t>> levels;
+    std::vector<uint8_t> level;
+    const std::vector<uint8_t>* texels = &data_;
+    uint32_t width = width_;
+    uint32_t height = height_;
+    while (true) {
+        levels.push_back(detail::compressBc(texels->data(), width, height, channels_, threads));
+        if (width == 1 && height == 1) {
+            break;
+        }
+        level = halve(*texels, width, height, channels_, threads);
+        texels = &level;
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+    }
 
-            double color = 0;
+    const auto vkFormat = channels_ == 2 ? detail::VK_FORMAT_BC5_UNORM_BLOCK : detail::VK_FORMAT_BC4_UNORM_BLOCK;
+    return Image{width_, height_, channels_, Type::KTX2, detail::ktx2File(vkFormat, width_, height_, levels)};
+}
 
-            for (int sy = -blurKernelSize; sy <= blurKernelSize; sy++) {
-                for (int sx = -blurKernelSize; sx <= blurKernelSize; sx++) {
-                    auto hypotSq = (sx * sx + sy * sy);
-                    auto div = 2.0 * sigma * sigma;
-                    auto weight = std::exp(-hypotSq / div) / (div * M_PI);
-                    auto idx = std::clamp<size_t>((y + sy) * width() + (x + sx), minIdx, maxIdx);
+void Image::blur(uint8_t blurKernelSize, size_t threads) {
+    blur(nullptr, blurKernelSize, threads);
+}
 
-                    auto val = data_[idx * channels() + 0];
-                    if (val == 0)
-                        continue;
-                    color += val * weight;
-                    sum += weight;
+void Image::blur(const Image& mask, uint8_t blurKernelSize, size_t threads) {
+    assert(mask.width() == width_ && mask.height() == height_ && mask.channels() == 1);
+    blur(&mask, blurKernelSize, threads);
+}
+
+void Image::blur(const Image* mask, uint8_t blurKernelSize, size_t threads) {
+    assert(type_ == Type::RAW);
+    if (blurKernelSize == 0) {
+        return;
+    }
+
+    const int radius = blurKernelSize;
+    const size_t width = width_;
+    const size_t height = height_;
+    // The alpha channel of RGBA images stays opaque
+    const size_t colors = channels_ == 4 ? 3 : channels_;
+    const auto kernel = blurKernel(radius);
+
+    // Texels that contribute, and whose value may change
+    auto valid = [&](size_t i) { return mask ? mask->data_[i] != 0 : data_[i * channels_] != 0; };
+
+    // Horizontal pass into float planes: the summed weights first, then the weighted sum of every color channel.
+    // Rows are padded with empty texels, so the kernel never reads across row ends.
+    const size_t planes = colors + 1;
+    std::vector<float> horizontal(planes * width * height);
+    const auto tasks = (height + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    const auto workers = std::max<size_t>(1, std::min(parallel::threads(threads), tasks));
+    std::vector<std::vector<float>> padded(workers, std::vector<float>(planes * (width + 2 * radius)));
+
+    parallel::forEach(tasks, workers, [&](size_t task, size_t worker) {
+        auto& row = padded[worker];
+        const size_t rowSize = width + 2 * radius;
+        const auto endY = std::min(height, (task + 1) * ROWS_PER_TASK);
+        for (size_t y = task * ROWS_PER_TASK; y < endY; y++) {
+            for (size_t x = 0; x < width; x++) {
+                const auto i = y * width + x;
+                const float weight = valid(i) ? 1.0f : 0.0f;
+                row[radius + x] = weight;
+                for (size_t c = 0; c < colors; c++) {
+                    row[(c + 1) * rowSize + radius + x] = weight * data_[i * channels_ + c];
                 }
             }
 
-            color /= sum;
+            for (size_t plane = 0; plane < planes; plane++) {
+                auto* out = &horizontal[(plane * height + y) * width];
+                const auto* in = &row[plane * rowSize];
+                std::fill_n(out, width, 0.0f);
+                for (int tap = -radius; tap <= radius; tap++) {
+                    accumulate(out, in + radius + tap, kernel[std::abs(tap)], width);
+                }
+            }
+        }
+    });
+
+    // Vertical pass, normalized by the summed weights of the texels that contributed
+    std::vector<std::vector<float>> sums(workers, std::vector<float>(planes * width));
+    parallel::forEach(tasks, workers, [&](size_t task, size_t worker) {
+        auto& sum = sums[worker];
+        const auto endY = std::min(height, (task + 1) * ROWS_PER_TASK);
+        for (size_t y = task * ROWS_PER_TASK; y < endY; y++) {
+            std::fill(sum.begin(), sum.end(), 0.0f);
+            const auto minY = std::max<int64_t>(0, static_cast<int64_t>(y) - radius);
+            const auto maxY = std::min<int64_t>(height - 1, y + radius);
+            for (auto sy = minY; sy <= maxY; sy++) {
+                const auto weight = kernel[std::abs(sy - static_cast<int64_t>(y))];
+                for (size_t plane = 0; plane < planes; plane++) {
+                    accumulate(&sum[plane * width], &horizontal[(plane * height + sy) * width], weight, width);
+                }
+            }
 
-            for (size_t i = 0; i < channels(); i++) {
-                data()[srcIdx * channels() + i] = (uint8_t) (std::min(color, 255.0));
+            for (size_t x = 0; x < width; x++) {
+                const auto i = y * width + x;
+                const auto weight = sum[x];
+                if (weight <= 0.0f || (mask && !valid(i))) {
+                    continue;
+                }
+                for (size_t c = 0; c < colors; c++) {
+                    data_[i * channels_ + c] = static_cast<uint8_t>(std::min(sum[(c + 1) * width + x] / weight + 0.5f, 255.0f));
+                }
+                if (channels_ == 4) {
+                    data_[i * 4 + 3] = 255;
+                }
             }
-            if (channels() == 4) {
-                data()[srcIdx * 4 + 3] = 255;
+        }
+    });
+}
+
+void Image::denoise(const DenoiseGuides& guides, const DenoiseOptions& options) {
+    assert(type_ == Type::RAW);
+    const size_t width = width_;
+    const size_t height = height_;
+    const size_t texels = width * height;
+    assert(guides.positions.size() == texels && guides.normals.size() == texels && guides.charts.size() == texels);
+
+    const size_t colors = channels_ == 4 ? 3 : channels_;
+    std::vector<float> values(texels * colors);
+    for (size_t i = 0; i < texels; i++) {
+        for (size_t c = 0; c < colors; c++) {
+            values[i * colors + c] = data_[i * channels_ + c] / 255.0f;
+        }
+    }
+    std::vector<float> next(values);
+
+    const auto planeScale = texelSize(guides, width) * options.planeSigma;
+    const auto tasks = (height + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    for (uint32_t iteration = 0; iteration < options.iterations; iteration++) {
+        const int step = 1 << iteration;
+        const float valueSigma = options.valueSigma / static_cast<float>(step);
+        const float planeSigma = planeScale * static_cast<float>(step);
+
+        parallel::forEach(tasks, options.threads, [&](size_t task, size_t) {
+            const auto endY = std::min(height, (task + 1) * ROWS_PER_TASK);
+            for (size_t y = task * ROWS_PER_TASK; y < endY; y++) {
+                for (size_t x = 0; x < width; x++) {
+                    const auto i = y * width + x;
+                    const auto chart = guides.charts[i];
+                    if (chart == 0) {
+                        continue;
+                    }
+
+                    const auto& position = guides.positions[i];
+                    const auto& normal = guides.normals[i];
+                    float value = 0.0f;
+                    for (size_t c = 0; c < colors; c++) {
+                        value += values[i * colors + c];
+                    }
+                    value /= colors;
+
+                    std::array<float, 4> sum{};
+                    float weights = 0.0f;
+                    for (int ky = -2; ky <= 2; ky++) {
+                        const auto sy = static_cast<int64_t>(y) + ky * step;
+                        if (sy < 0 || sy >= static_cast<int64_t>(height)) {
+                            continue;
+                        }
+                        for (int kx = -2; kx <= 2; kx++) {
+                            const auto sx = static_cast<int64_t>(x) + kx * step;
+                            if (sx < 0 || sx >= static_cast<int64_t>(width)) {
+                                continue;
+                            }
+                            const auto j = static_cast<size_t>(sy) * width + sx;
+                            if (guides.charts[j] != chart) {
+                                continue;
+                            }
+
+                            float sample = 0.0f;
+                            for (size_t c = 0; c < colors; c++) {
+                                sample += values[j * colors + c];
+                            }
+                            sample /= colors;
+
+                            const auto cosine = std::max(0.0f, glm::dot(normal, guides.normals[j]));
+                            const auto plane = glm::dot(normal, guides.positions[j] - position) / planeSigma;
+                            const auto difference = std::abs(sample - value) / valueSigma;
+                            const auto weight = ATROUS_KERNEL[kx + 2] * ATROUS_KERNEL[ky + 2] * std::pow(cosine, options.normalPower) *
+                                                std::exp(-0.5f * plane * plane - difference);
+                            for (size_t c = 0; c < colors; c++) {
+                                sum[c] += weight * values[j * colors + c];
+                            }
+                            weights += weight;
+                        }
+                    }
+
+                    if (weights <= 0.0f) {
+                        continue;
+                    }
+                    for (size_t c = 0; c < colors; c++) {
+                        next[i * colors + c] = sum[c] / weights;
+                    }
+                }
             }
+        });
+        values.swap(next);
+    }
+
+    for (size_t i = 0; i < texels; i++) {
+        if (guides.charts[i] == 0) {
+            continue;
+        }
+        for (size_t c = 0; c < colors; c++) {
+            data_[i * channels_ + c] = static_cast<uint8_t>(std::clamp(values[i * colors + c] * 255.0f + 0.5f, 0.0f, 255.0f));
         }
+        if (channels_ == 4) {
+            data_[i * 4 + 3] = 255;
+        }
+    }
+}
+
+void Image::dilate(const Image& mask, uint32_t gutter, size_t threads) {
+    assert(type_ == Type::RAW);
+    assert(mask.width() == width_ && mask.height() == height_ && mask.channels() == 1);
+    if (gutter == 0) {
+        return;
+    }
+
+    const int width = width_;
+    const int height = height_;
+    std::vector<int32_t> seeds(data_.size() / channels_);
+    std::vector<int32_t> next(seeds.size());
+    for (size_t i = 0; i < seeds.size(); i++) {
+        seeds[i] = mask.data_[i] ? static_cast<int32_t>(i) : NO_SEED;
+    }
+
+    // Steps of half the next power of two above the gutter down to 1 reach every texel within the gutter, followed
+    // by one more pass of 1 that fixes most of the errors of plain jump flooding
+    uint32_t step = 1;
+    while (step <= gutter) {
+        step *= 2;
+    }
+    for (step /= 2; step > 0; step /= 2) {
+        jumpFlood(seeds, next, width, height, step, threads);
+        seeds.swap(next);
     }
+    jumpFlood(seeds, next, width, height, 1, threads);
+    seeds.swap(next);
+
+    // Only texels outside of the mask are written, and only texels inside are read
+    const int64_t maxDistance = static_cast<int64_t>(gutter) * gutter;
+    const auto tasks = (height + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    parallel::forEach(tasks, threads, [&](size_t task, size_t) {
+        const int endY = std::min<int>(height, (task + 1) * ROWS_PER_TASK);
+        for (int y = task * ROWS_PER_TASK; y < endY; y++) {
+            for (int x = 0; x < width; x++) {
+                const size_t i = static_cast<size_t>(y) * width + x;
+                const auto seed = seeds[i];
+                if (mask.data_[i] || seed == NO_SEED) {
+                    continue;
+                }
+                int64_t dx = seed % width - x;
+                int64_t dy = seed / width - y;
+                if (dx * dx + dy * dy <= maxDistance) {
+                    std::copy_n(&data_[static_cast<size_t>(seed) * channels_], channels_, &data_[i * channels_]);
+                }
+            }
+        }
+    });
 }
 
 } // namespace meshtools
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "ktx2.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+namespace meshtools::detail {
+
+namespace {
+
+const constexpr uint8_t IDENTIFIER[12] = {0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n'};
+// Identifier, header and index, followed by the level index
+const constexpr size_t INDEX_OFFSET = 48;
+const constexpr size_t HEADER_SIZE = 80;
+const constexpr size_t LEVEL_INDEX_ENTRY_SIZE = 24;
+
+// Data format descriptor values (Khronos Data Format Specification 1.3)
+const constexpr uint32_t KHR_DF_MODEL_BC4 = 131;
+const constexpr uint32_t KHR_DF_MODEL_BC5 = 132;
+const constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+const constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+const constexpr uint32_t KHR_DF_VERSION = 2;
+
+void appendUint32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+void setUint32(std::vector<uint8_t>& out, size_t offset, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+void setUint64(std::vector<uint8_t>& out, size_t offset, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        out[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint32_t readUint32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+void pad(std::vector<uint8_t>& out, size_t alignment) {
+    out.resize((out.size() + alignment - 1) / alignment * alignment, 0);
+}
+
+// A basic descriptor block with a 64 bit sample per channel
+void appendDataFormatDescriptor(std::vector<uint8_t>& out, uint32_t vkFormat) {
+    const uint32_t channels = vkFormat == VK_FORMAT_BC5_UNORM_BLOCK ? 2 : 1;
+    const uint32_t blockSize = 24 + 16 * channels;
+
+    appendUint32(out, 4 + blockSize);
+    // Vendor and descriptor type (both 0: Khronos, basic)
+    appendUint32(out, 0);
+    appendUint32(out, KHR_DF_VERSION | (blockSize << 16));
+    const auto model = channels == 2 ? KHR_DF_MODEL_BC5 : KHR_DF_MODEL_BC4;
+    appendUint32(out, model | (KHR_DF_PRIMARIES_BT709 << 8) | (KHR_DF_TRANSFER_LINEAR << 16));
+    // 4x4 texels per block (stored minus one)
+    appendUint32(out, 3 | (3 << 8));
+    // Bytes per block
+    appendUint32(out, 8 * channels);
+    appendUint32(out, 0);
+
+    for (uint32_t channel = 0; channel < channels; channel++) {
+        // Bit offset, bit length - 1 and channel id (red, green)
+        appendUint32(out, (64 * channel) | (63 << 16) | (channel << 24));
+        appendUint32(out, 0);
+        appendUint32(out, 0);
+        appendUint32(out, 0xffffffff);
+    }
+}
+
+} // namespace
+
+std::vector<uint8_t> ktx2File(uint32_t vkFormat, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& levels) {
+    assert(vkFormat == VK_FORMAT_BC4_UNORM_BLOCK || vkFormat == VK_FORMAT_BC5_UNORM_BLOCK);
+    assert(!levels.empty());
+
+    std::vector<uint8_t> out(IDENTIFIER, IDENTIFIER + sizeof(IDENTIFIER));
+    appendUint32(out, vkFormat);
+    // Type size, 1 for block compressed formats
+    appendUint32(out, 1);
+    appendUint32(out, width);
+    appendUint32(out, height);
+    // Depth, layers, faces, levels and supercompression
+    appendUint32(out, 0);
+    appendUint32(out, 0);
+    appendUint32(out, 1);
+    appendUint32(out, static_cast<uint32_t>(levels.size()));
+    appendUint32(out, 0);
+
+    // The indices are filled in once the offsets are known; there is no supercompression global data
+    out.resize(HEADER_SIZE + LEVEL_INDEX_ENTRY_SIZE * levels.size(), 0);
+
+    const auto dfdOffset = out.size();
+    appendDataFormatDescriptor(out, vkFormat);
+    const auto dfdSize = out.size() - dfdOffset;
+
+    const auto kvdOffset = out.size();
+    const std::string key = "KTXwriter";
+    const std::string value = "meshtools";
+    appendUint32(out, static_cast<uint32_t>(key.size() + value.size() + 2));
+    out.insert(out.end(), key.begin(), key.end());
+    out.push_back(0);
+    out.insert(out.end(), value.begin(), value.end());
+    out.push_back(0);
+    pad(out, 4);
+    const auto kvdSize = out.size() - kvdOffset;
+
+    setUint32(out, INDEX_OFFSET, static_cast<uint32_t>(dfdOffset));
+    setUint32(out, INDEX_OFFSET + 4, static_cast<uint32_t>(dfdSize));
+    setUint32(out, INDEX_OFFSET + 8, static_cast<uint32_t>(kvdOffset));
+    setUint32(out, INDEX_OFFSET + 12, static_cast<uint32_t>(kvdSize));
+
+    // Levels are stored from the smallest to the largest, aligned to their blocks
+    const size_t alignment = vkFormat == VK_FORMAT_BC5_UNORM_BLOCK ? 16 : 8;
+    for (size_t level = levels.size(); level-- > 0;) {
+        pad(out, alignment);
+        const auto entry = HEADER_SIZE + LEVEL_INDEX_ENTRY_SIZE * level;
+        setUint64(out, entry, out.size());
+        setUint64(out, entry + 8, levels[level].size());
+        setUint64(out, entry + 16, levels[level].size());
+        out.insert(out.end(), levels[level].begin(), levels[level].end());
+    }
+
+    return out;
+}
+
+bool ktx2Info(const uint8_t* data, size_t size, uint32_t& width, uint32_t& height, uint32_t& vkFormat) {
+    if (size < HEADER_SIZE || !std::equal(IDENTIFIER, IDENTIFIER + sizeof(IDENTIFIER), data)) {
+        return false;
+    }
+    vkFormat = readUint32(data + 12);
+    width = readUint32(data + 20);
+    height = readUint32(data + 24);
+    return true;
+}
+
+} // namespace meshtools::detail
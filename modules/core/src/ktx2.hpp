@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace meshtools::detail {
+
+// Vulkan formats of the BC4 and BC5 blocks
+const constexpr uint32_t VK_FORMAT_BC4_UNORM_BLOCK = 139;
+const constexpr uint32_t VK_FORMAT_BC5_UNORM_BLOCK = 141;
+
+// A KTX2 file of a 2D texture in one of the formats above, with its mip levels from the largest (width x height)
+// to the smallest. The levels are stored as they are, without supercompression.
+std::vector<uint8_t> ktx2File(uint32_t vkFormat, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& levels);
+
+// Reads the size and format from the header of a KTX2 file; false if it isn't one
+bool ktx2Info(const uint8_t* data, size_t size, uint32_t& width, uint32_t& height, uint32_t& vkFormat);
+
+} // namespace meshtools::detail
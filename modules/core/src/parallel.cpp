@@ -0,0 +1,140 @@
+#include <meshtools/parallel.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace meshtools::parallel {
+
+namespace {
+
+struct WorkQueue {
+    std::mutex mutex;
+    size_t begin = 0;
+    size_t end = 0;
+
+    bool pop(size_t& task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (begin == end) {
+            return false;
+        }
+        task = begin++;
+        return true;
+    }
+
+    size_t remaining() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return end - begin;
+    }
+};
+
+// Moves the back half of the fullest queue into the (empty) thief queue
+bool steal(std::vector<WorkQueue>& queues, size_t thief) {
+    while (true) {
+        size_t victim = queues.size();
+        size_t victimRemaining = 0;
+        for (size_t i = 0; i < queues.size(); i++) {
+            if (i == thief) {
+                continue;
+            }
+            auto remaining = queues[i].remaining();
+            if (remaining > victimRemaining) {
+                victim = i;
+                victimRemaining = remaining;
+            }
+        }
+
+        if (victim == queues.size()) {
+            return false;
+        }
+
+        // Lock in a fixed order to avoid dead-locking against a concurrent thief
+        auto& a = queues[std::min(victim, thief)];
+        auto& b = queues[std::max(victim, thief)];
+        std::scoped_lock lock(a.mutex, b.mutex);
+
+        auto& from = queues[victim];
+        auto& to = queues[thief];
+        auto available = from.end - from.begin;
+        if (available == 0) {
+            // Raced with the owner or another thief, look again
+            continue;
+        }
+
+        auto take = std::max<size_t>(1, available / 2);
+        to.begin = from.end - take;
+        to.end = from.end;
+        from.end -= take;
+        return true;
+    }
+}
+
+} // namespace
+
+size_t concurrency() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void forEach(size_t taskCount, size_t threadCount, const std::function<void(size_t task, size_t worker)>& fn) {
+    if (taskCount == 0) {
+        return;
+    }
+
+    auto workerCount = std::min(threads(threadCount), taskCount);
+    if (workerCount == 1) {
+        for (size_t task = 0; task < taskCount; task++) {
+            fn(task, 0);
+        }
+        return;
+    }
+
+    std::vector<WorkQueue> queues(workerCount);
+    for (size_t i = 0; i < workerCount; i++) {
+        queues[i].begin = taskCount * i / workerCount;
+        queues[i].end = taskCount * (i + 1) / workerCount;
+    }
+
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    auto work = [&](size_t worker) {
+        auto& queue = queues[worker];
+        size_t task;
+        while (true) {
+            if (!queue.pop(task)) {
+                if (!steal(queues, worker)) {
+                    break;
+                }
+                continue;
+            }
+
+            try {
+                fn(task, worker);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workerCount - 1);
+    for (size_t worker = 1; worker < workerCount; worker++) {
+        pool.emplace_back(work, worker);
+    }
+    work(0);
+
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace meshtools::parallel
@@ -0,0 +1,153 @@
+#include "png.hpp"
+
+#include "deflate.hpp"
+
+#include <meshtools/parallel.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <limits>
+
+namespace meshtools::detail {
+
+namespace {
+
+// Rows are compressed in bands of at least this many bytes; smaller bands compress worse
+const constexpr size_t BAND_BYTES = size_t{1} << 18;
+
+void appendUint32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+uint8_t paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return static_cast<uint8_t>(a);
+    }
+    return static_cast<uint8_t>(pb <= pc ? b : c);
+}
+
+// Writes the filter type and the filtered row (size + 1 bytes) to best; candidate is scratch space of the same size
+void filterRow(const uint8_t* row, const uint8_t* previous, size_t size, uint8_t bpp, std::vector<uint8_t>& candidate,
+               std::vector<uint8_t>& best) {
+    uint64_t bestSum = std::numeric_limits<uint64_t>::max();
+    for (uint8_t filter = 0; filter < 5; filter++) {
+        auto& out = candidate;
+        out[0] = filter;
+        uint64_t sum = 0;
+        for (size_t i = 0; i < size; i++) {
+            int a = i >= bpp ? row[i - bpp] : 0;
+            int b = previous ? previous[i] : 0;
+            int c = i >= bpp && previous ? previous[i - bpp] : 0;
+            uint8_t predicted = 0;
+            switch (filter) {
+                case 1:
+                    predicted = a;
+                    break;
+                case 2:
+                    predicted = b;
+                    break;
+                case 3:
+                    predicted = (a + b) / 2;
+                    break;
+                case 4:
+                    predicted = paeth(a, b, c);
+                    break;
+                default:
+                    break;
+            }
+            uint8_t value = row[i] - predicted;
+            out[i + 1] = value;
+            sum += value < 128 ? value : 256 - value;
+        }
+        if (sum < bestSum) {
+            bestSum = sum;
+            std::swap(best, candidate);
+        }
+    }
+}
+
+} // namespace
+
+std::vector<uint8_t> pngHeader(uint32_t width, uint32_t height, uint8_t channels) {
+    std::vector<uint8_t> out{0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+    // Gray, gray + alpha, RGB and RGBA
+    const std::array<uint8_t, 5> colorTypes{0, 0, 4, 2, 6};
+    std::vector<uint8_t> header;
+    appendUint32(header, width);
+    appendUint32(header, height);
+    header.push_back(8); // Bit depth
+    header.push_back(colorTypes[channels]);
+    header.push_back(0); // Compression
+    header.push_back(0); // Filter method
+    header.push_back(0); // No interlacing
+    appendPngChunk(out, "IHDR", header.data(), header.size());
+    return out;
+}
+
+void appendPngChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size) {
+    appendUint32(out, static_cast<uint32_t>(size));
+    out.insert(out.end(), type, type + 4);
+    auto crc = crc32(0, reinterpret_cast<const uint8_t*>(type), 4);
+    if (size > 0) {
+        out.insert(out.end(), data, data + size);
+        crc = crc32(crc, data, size);
+    }
+    appendUint32(out, crc);
+}
+
+void compressRows(const uint8_t* rows, uint32_t count, const uint8_t* previous, uint32_t width, uint8_t channels, size_t threads,
+                  std::vector<uint8_t>& out, uint32_t& adler) {
+    if (count == 0) {
+        return;
+    }
+
+    const size_t rowSize = static_cast<size_t>(width) * channels;
+    const auto bandRows = static_cast<uint32_t>(std::max<size_t>(1, BAND_BYTES / (rowSize + 1)));
+    const auto bands = (count + bandRows - 1) / bandRows;
+
+    struct Band {
+        std::vector<uint8_t> compressed;
+        uint32_t adler = 1;
+        size_t size = 0;
+    };
+    std::vector<Band> results(bands);
+
+    parallel::forEach(bands, threads, [&](size_t band, size_t) {
+        std::vector<uint8_t> candidate(rowSize + 1);
+        std::vector<uint8_t> best(rowSize + 1);
+        Deflater deflater;
+        auto& result = results[band];
+        result.compressed.reserve(bandRows * rowSize / 2);
+
+        const auto begin = static_cast<uint32_t>(band) * bandRows;
+        const auto end = std::min(count, begin + bandRows);
+        for (auto row = begin; row < end; row++) {
+            const auto* above = row > 0 ? rows + (row - 1) * rowSize : previous;
+            filterRow(rows + row * rowSize, above, rowSize, channels, candidate, best);
+            result.adler = adler32(result.adler, best.data(), best.size());
+            result.size += best.size();
+            deflater.compress(best.data(), best.size(), result.compressed);
+        }
+        deflater.flush(result.compressed);
+    });
+
+    size_t total = 0;
+    for (const auto& result : results) {
+        total += result.compressed.size();
+    }
+    out.reserve(out.size() + total);
+    for (const auto& result : results) {
+        out.insert(out.end(), result.compressed.begin(), result.compressed.end());
+        adler = adler32Combine(adler, result.adler, result.size);
+    }
+}
+
+} // namespace meshtools::detail
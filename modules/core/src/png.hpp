@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace meshtools::detail {
+
+// The PNG signature followed by the IHDR chunk of an 8-bit image with 1 to 4 channels
+std::vector<uint8_t> pngHeader(uint32_t width, uint32_t height, uint8_t channels);
+
+// Appends a chunk with its length and checksum
+void appendPngChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size);
+
+// Filters every row with the filter that gives the smallest sum of absolute values (like most encoders do) and
+// deflates the result. Bands of rows are compressed independently on up to `threads` threads, and appended to `out`
+// as flushed deflate data (see Deflater). `previous` is the row before the first one, or nullptr at the top of the
+// image; `adler` is updated with the filtered data.
+void compressRows(const uint8_t* rows, uint32_t count, const uint8_t* previous, uint32_t width, uint8_t channels, size_t threads,
+                  std::vector<uint8_t>& out, uint32_t& adler);
+
+} // namespace meshtools::detail
@@ -0,0 +1,128 @@
+#include <meshtools/png_writer.hpp>
+
+#include <meshtools/logging.hpp>
+
+#include "deflate.hpp"
+#include "png.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <vector>
+
+namespace meshtools {
+
+namespace {
+
+// Compressed data is written in IDAT chunks of about this size
+const constexpr size_t CHUNK_SIZE = 1 << 16;
+
+} // namespace
+
+class PngWriter::Impl {
+public:
+    void writeChunk(const char* type, const uint8_t* data, size_t size) {
+        chunk.clear();
+        detail::appendPngChunk(chunk, type, data, size);
+        file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+    }
+
+    std::ofstream file;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint8_t channels = 0;
+    uint32_t rows = 0;
+
+    // The last row written, which the filters of the next one refer to
+    std::vector<uint8_t> previous;
+
+    std::vector<uint8_t> compressed{detail::ZLIB_HEADER, detail::ZLIB_HEADER + 2};
+    uint32_t adler = 1;
+    std::vector<uint8_t> chunk;
+};
+
+PngWriter::PngWriter() : impl_(std::make_unique<Impl>()) {}
+
+PngWriter::~PngWriter() = default;
+
+Result<PngWriter> PngWriter::Open(const std::filesystem::path& path, uint32_t width, uint32_t height, uint8_t channels) {
+    if (width == 0 || height == 0 || channels == 0 || channels > 4) {
+        return {"Invalid PNG dimensions"};
+    }
+
+    Result<PngWriter> result{std::make_shared<PngWriter>()};
+    auto& impl = *result.value->impl_;
+    impl.file.open(path, std::ios::binary);
+    if (!impl.file.is_open()) {
+        return {"Cannot write to file " + path.string()};
+    }
+
+    impl.width = width;
+    impl.height = height;
+    impl.channels = channels;
+    impl.previous.resize(static_cast<size_t>(width) * channels);
+
+    auto header = detail::pngHeader(width, height, channels);
+    impl.file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+    return result;
+}
+
+uint32_t PngWriter::width() const {
+    return impl_->width;
+}
+
+uint32_t PngWriter::height() const {
+    return impl_->height;
+}
+
+uint8_t PngWriter::channels() const {
+    return impl_->channels;
+}
+
+uint32_t PngWriter::rows() const {
+    return impl_->rows;
+}
+
+void PngWriter::write(const uint8_t* data, uint32_t count, size_t threads) {
+    auto& impl = *impl_;
+    assert(impl.rows + count <= impl.height);
+    if (count == 0) {
+        return;
+    }
+
+    const size_t rowSize = static_cast<size_t>(impl.width) * impl.channels;
+    detail::compressRows(data, count, impl.rows > 0 ? impl.previous.data() : nullptr, impl.width, impl.channels, threads, impl.compressed, impl.adler);
+    std::copy_n(data + (count - 1) * rowSize, rowSize, impl.previous.begin());
+    impl.rows += count;
+
+    if (impl.compressed.size() >= CHUNK_SIZE) {
+        impl.writeChunk("IDAT", impl.compressed.data(), impl.compressed.size());
+        impl.compressed.clear();
+    }
+}
+
+bool PngWriter::finish() {
+    auto& impl = *impl_;
+    if (impl.rows != impl.height) {
+        logging::error("PNG incomplete, {} of {} rows written", impl.rows, impl.height);
+        return false;
+    }
+
+    impl.compressed.insert(impl.compressed.end(), detail::DEFLATE_END, detail::DEFLATE_END + 2);
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        impl.compressed.push_back(static_cast<uint8_t>(impl.adler >> shift));
+    }
+    impl.writeChunk("IDAT", impl.compressed.data(), impl.compressed.size());
+    impl.compressed.clear();
+    impl.writeChunk("IEND", nullptr, 0);
+    impl.file.close();
+
+    if (!impl.file) {
+        logging::error("Could not write PNG file");
+        return false;
+    }
+    return true;
+}
+
+} // namespace meshtools
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+
+namespace meshtools::models {
+
+// Memory for the geometry buffers of a model. Allocations bump a pointer through large blocks, freeing them does
+// nothing, and all blocks are released at once when the arena is destroyed. It can be used from several threads.
+//
+// Buffers that are allocated from an arena keep it alive (see TypedData), so meshes can outlive their model.
+class Arena : public std::pmr::memory_resource {
+public:
+    // The size of the first block; later ones grow geometrically
+    explicit Arena(size_t initialSize = size_t{1} << 20);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Bytes taken from the heap
+    size_t footprint() const;
+
+    // Bytes handed out to allocations, which includes what they freed again
+    size_t used() const;
+
+private:
+    // Counts the blocks of the arena
+    class Upstream : public std::pmr::memory_resource {
+    public:
+        size_t allocated = 0;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    mutable std::mutex mutex_;
+    Upstream upstream_;
+    std::pmr::monotonic_buffer_resource resource_;
+    size_t used_ = 0;
+};
+
+} // namespace meshtools::models
@@ -1,29 +1,58 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <string>
+#include <string_view>
 
 namespace meshtools::models {
 
-struct AttributeType {
-    const std::string name;
+// A vertex attribute, by an interned id. The common glTF attributes have fixed ids in the order of the glTF spec;
+// other names (like _FEATURE_ID_0) get the next free id when they are first used. Comparing and hashing attributes
+// only looks at the id.
+class AttributeType {
+public:
+    AttributeType(std::string_view name);
+
+    uint32_t id() const {
+        return id_;
+    }
+
+    const std::string& name() const;
+
+    // The common glTF attributes have the ids below this one
+    constexpr static uint32_t COMMON_COUNT = 15;
 
     // Common attribute types
     const static AttributeType POSITION;
     const static AttributeType NORMAL;
     const static AttributeType TEXCOORD;
     const static AttributeType COLOR;
-};
 
-static bool operator==(const AttributeType& lhs, const AttributeType& rhs) {
-    return lhs.name == rhs.name;
-}
+    friend bool operator==(const AttributeType& lhs, const AttributeType& rhs) {
+        return lhs.id_ == rhs.id_;
+    }
+
+    friend bool operator!=(const AttributeType& lhs, const AttributeType& rhs) {
+        return lhs.id_ != rhs.id_;
+    }
+
+    // Orders the common attributes first
+    friend bool operator<(const AttributeType& lhs, const AttributeType& rhs) {
+        return lhs.id_ < rhs.id_;
+    }
+
+private:
+    constexpr explicit AttributeType(uint32_t id) : id_(id) {}
+
+    uint32_t id_;
+};
 
 } // namespace meshtools::models
 
 template<>
 struct std::hash<meshtools::models::AttributeType> {
     std::size_t operator()(meshtools::models::AttributeType const& s) const noexcept {
-        return std::hash<std::string>{}(s.name);
+        return s.id();
     }
-};
\ No newline at end of file
+};
@@ -4,26 +4,23 @@
 #include <meshtools/models/attribute_type.hpp>
 #include <meshtools/models/extras.hpp>
 #include <meshtools/models/mesh_data.hpp>
+#include <meshtools/models/vertex_data.hpp>
 
 #include <string>
-#include <unordered_map>
 #include <utility>
 
 namespace meshtools::models {
 
-using VertexData = std::unordered_map<AttributeType, TypedData>;
-
 class Mesh {
 public:
     Mesh(std::string name, int materialIdx, TypedData indices, VertexData vertexData, Extra extra = {})
         : name_(std::move(name)), materialIdx_(materialIdx), indices_(std::move(indices)), vertexData_(std::move(vertexData)),
           extra_(std::move(extra)) {}
 
-    // Delete copy
-    Mesh(const Mesh&) = delete;
-    Mesh& operator=(const Mesh&) = delete;
+    // Copies share the index and vertex buffers until they are changed, see TypedData
+    Mesh(const Mesh&) = default;
+    Mesh& operator=(const Mesh&) = default;
 
-    // Keep move
     Mesh(Mesh&&) = default;
     Mesh& operator=(Mesh&&) = default;
 
@@ -3,46 +3,22 @@
 #include <meshtools/algorithm.hpp>
 #include <meshtools/logging.hpp>
 #include <meshtools/math.hpp>
+#include <meshtools/models/arena.hpp>
 #include <meshtools/result.hpp>
 #include <meshtools/span.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace meshtools::models {
 
-namespace detail {
-
-template<typename T, bool = std::is_arithmetic<T>::value>
-struct Converter {};
-
-template<typename T>
-struct Converter<T, true> {
-
-    T operator()(const uint8_t* data, size_t /*components*/, size_t componentByteSize) {
-        assert(componentByteSize <= sizeof(T));
-        T result{};
-        memcpy(&result, data, componentByteSize);
-        return result;
-    }
-};
-
-template<typename T>
-struct Converter<T, false> {
-
-    T operator()(const uint8_t* data, size_t components, size_t componentByteSize) {
-        assert(componentByteSize <= sizeof(T));
-        T result{};
-        for (size_t i = 0; i < components; i++) {
-            memcpy(&result[i], data + i * componentByteSize, componentByteSize);
-        }
-        return result;
-    }
-};
-
-} // namespace detail
-
-
 enum class DataType {
     FLOAT,
     DOUBLE,
@@ -78,7 +54,7 @@ inline size_t bytes(DataType dataType) {
 
 template<class T>
 constexpr inline DataType toDataType() {
-    if constexpr (std::is_same_v<char, T>) {
+    if constexpr (std::is_same_v<char, T> || std::is_same_v<signed char, T>) {
         return DataType::BYTE;
     } else if constexpr (std::is_same_v<unsigned char, T>) {
         return DataType::U_BYTE;
@@ -100,6 +76,89 @@ constexpr inline DataType toDataType() {
     }
 }
 
+namespace detail {
+
+// The component type of T, which is either arithmetic itself or a glm vector
+template<class T, bool = std::is_arithmetic_v<T>>
+struct ComponentOf {
+    using type = T;
+};
+
+template<class T>
+struct ComponentOf<T, false> {
+    using type = typename T::value_type;
+};
+
+template<class T>
+using Component = typename ComponentOf<T>::type;
+
+template<class T>
+Component<T>& component(T& value, size_t index) {
+    if constexpr (std::is_arithmetic_v<T>) {
+        assert(index == 0);
+        return value;
+    } else {
+        return value[index];
+    }
+}
+
+// Integers to [0, 1] (unsigned) or [-1, 1] (signed), like the normalized accessors of glTF
+template<class S>
+float normalize(S value) {
+    if constexpr (std::is_integral_v<S>) {
+        return std::max(static_cast<float>(value) / static_cast<float>(std::numeric_limits<S>::max()), -1.0f);
+    } else {
+        return static_cast<float>(value);
+    }
+}
+
+// Reads an element of `components` components of type S and converts them to the components of T
+template<class T, class S, bool Normalized>
+T convert(const uint8_t* data, size_t components) {
+    T result{};
+    for (size_t i = 0; i < components; i++) {
+        S value;
+        std::memcpy(&value, data + i * sizeof(S), sizeof(S));
+        if constexpr (Normalized) {
+            component(result, i) = static_cast<Component<T>>(normalize(value));
+        } else {
+            component(result, i) = static_cast<Component<T>>(value);
+        }
+    }
+    return result;
+}
+
+template<class T, bool Normalized>
+using ConvertFn = T (*)(const uint8_t*, size_t);
+
+template<class T, bool Normalized>
+ConvertFn<T, Normalized> converter(DataType dataType) {
+    switch (dataType) {
+        case DataType::BYTE:
+            return &convert<T, int8_t, Normalized>;
+        case DataType::U_BYTE:
+            return &convert<T, uint8_t, Normalized>;
+        case DataType::SHORT:
+            return &convert<T, int16_t, Normalized>;
+        case DataType::U_SHORT:
+            return &convert<T, uint16_t, Normalized>;
+        case DataType::INT:
+            return &convert<T, int32_t, Normalized>;
+        case DataType::U_INT:
+            return &convert<T, uint32_t, Normalized>;
+        case DataType::FLOAT:
+            return &convert<T, float, Normalized>;
+        case DataType::DOUBLE:
+            return &convert<T, double, Normalized>;
+        case DataType::UNKNOWN:
+            break;
+    }
+    assert(false);
+    throw std::runtime_error("Unknown data type");
+}
+
+} // namespace detail
+
 struct TypedData {
     struct Iterator {
         using iterator_category = std::forward_iterator_tag;
@@ -187,34 +246,59 @@ struct TypedData {
     using const_iterator = ConstIterator;
     using value_type = span<uint8_t>;
 
+    using Buffer = std::pmr::vector<uint8_t>;
+
+    // Spare capacity the loaders reserve behind the data, so consumers that read in 16 byte blocks (like embree) can
+    // use the buffer in place
+    static constexpr size_t TAIL_PADDING = 16;
+
     template<class T>
-    static TypedData From(DataType dataType, size_t componentCount, const std::vector<T>& data) {
-        TypedData result(dataType, componentCount, data.size() * sizeof(T) / bytes(dataType) / componentCount);
+    static TypedData From(DataType dataType, size_t componentCount, const std::vector<T>& data, std::shared_ptr<Arena> arena = nullptr) {
+        TypedData result(dataType, componentCount, data.size() * sizeof(T) / bytes(dataType) / componentCount, std::move(arena));
         result.copyFrom(data.data());
         return result;
     }
 
     template<class T>
-    static TypedData From(size_t componentCount, const std::vector<T>& data) {
-        return From(toDataType<T>(), componentCount, data);
+    static TypedData From(size_t componentCount, const std::vector<T>& data, std::shared_ptr<Arena> arena = nullptr) {
+        return From(toDataType<T>(), componentCount, data, std::move(arena));
     }
 
-    TypedData(DataType dataType, size_t componentCount, std::vector<uint8_t> data)
-        : dataType_(dataType), componentCount_(componentCount), data_(std::move(data)) {}
+    // A copy of `data`
+    TypedData(DataType dataType, size_t componentCount, const std::vector<uint8_t>& data, std::shared_ptr<Arena> arena = nullptr)
+        : TypedData(dataType, componentCount, data.size() / bytes(dataType) / componentCount, std::move(arena)) {
+        copyFrom(data.data());
+    }
 
-    TypedData(DataType dataType, size_t componentCount, size_t count) : dataType_(dataType), componentCount_(componentCount) {
-        data_.resize(componentCount_ * bytes(dataType_) * count);
+    // Zeroed data for `count` elements, which is allocated from the arena if there is one
+    TypedData(DataType dataType, size_t componentCount, size_t count, std::shared_ptr<Arena> arena = nullptr)
+        : dataType_(dataType), componentCount_(componentCount), arena_(std::move(arena)), data_(allocate(arena_.get())) {
+        data_->reserve(componentCount_ * bytes(dataType_) * count + TAIL_PADDING);
+        data_->resize(componentCount_ * bytes(dataType_) * count);
     }
 
     TypedData() = default;
 
-    // Delete copy
-    TypedData(const TypedData&) = delete;
-    TypedData& operator=(const TypedData&) = delete;
+    // Copies share the buffer until one of them is changed (copy on write). Reading through const references never
+    // copies; the non-const accessors copy a shared buffer first.
+    TypedData(const TypedData&) = default;
+    TypedData& operator=(const TypedData&) = default;
+
+    // Moved-from data is empty and keeps its data type and component count
+    TypedData(TypedData&& other) noexcept
+        : dataType_(other.dataType_), componentCount_(other.componentCount_), arena_(std::move(other.arena_)),
+          data_(std::exchange(other.data_, emptyBuffer())) {
+    }
 
-    // Keep move
-    TypedData(TypedData&&) = default;
-    TypedData& operator=(TypedData&&) = default;
+    TypedData& operator=(TypedData&& other) noexcept {
+        if (this != &other) {
+            dataType_ = other.dataType_;
+            componentCount_ = other.componentCount_;
+            data_ = std::exchange(other.data_, emptyBuffer());
+            arena_ = std::move(other.arena_);
+        }
+        return *this;
+    }
 
     size_t componentCount() const {
         return componentCount_;
@@ -229,11 +313,21 @@ struct TypedData {
     }
 
     size_t size() const {
-        return data_.size() / stride();
+        return data_->size() / stride();
     }
 
-    const std::vector<uint8_t>& buffer() const {
-        return data_;
+    const Buffer& buffer() const {
+        return *data_;
+    }
+
+    // The arena the buffer is allocated from, nullptr for the heap
+    const std::shared_ptr<Arena>& arena() const {
+        return arena_;
+    }
+
+    // Whether the buffer is shared with another copy
+    bool shared() const {
+        return data_.use_count() > 1;
     }
 
     DataType dataType() const {
@@ -241,11 +335,12 @@ struct TypedData {
     }
 
     span<uint8_t> operator[](size_t pos) {
-        return {data_.data() + pos * stride(), stride()};
+        detach();
+        return {data_->data() + pos * stride(), stride()};
     }
 
     const span<const uint8_t> operator[](size_t pos) const {
-        return {data_.data() + pos * stride(), stride()};
+        return {data_->data() + pos * stride(), stride()};
     }
 
     iterator begin() {
@@ -271,27 +366,68 @@ struct TypedData {
             assert(false);
         }
 
-        data_.insert(data_.end(), other.data_.begin(), other.data_.end());
+        detach(other.data_->size());
+        data_->insert(data_->end(), other.data_->begin(), other.data_->end());
     }
 
     void copyTo(void* out) const {
-        std::memcpy(out, data_.data(), data_.size());
+        std::memcpy(out, data_->data(), data_->size());
     }
 
     void copyFrom(const void* in) {
-        std::memcpy(data_.data(), in, data_.size());
+        detach();
+        std::memcpy(data_->data(), in, data_->size());
     }
 
+    // A copy with the components converted to `dataType`, in bulk. With `normalized`, integers that are converted to
+    // floats are mapped to [0, 1] (unsigned) or [-1, 1] (signed), like the quantized attributes of
+    // KHR_mesh_quantization.
+    TypedData convert(DataType dataType, bool normalized = false) const;
+
     // TODO view()
 
 private:
+    // Gives this copy its own buffer before it is changed, with room for `extra` more bytes
+    void detach(size_t extra = 0) {
+        if (!shared()) {
+            return;
+        }
+        auto data = allocate(arena_.get());
+        data->reserve(data_->size() + extra + TAIL_PADDING);
+        data->assign(data_->begin(), data_->end());
+        data_ = std::move(data);
+    }
+
+    // The buffer and its shared_ptr control block are allocated together, from the arena if there is one
+    static std::shared_ptr<Buffer> allocate(Arena* arena) {
+        std::pmr::memory_resource* resource = arena ? arena : std::pmr::get_default_resource();
+        return std::allocate_shared<Buffer>(std::pmr::polymorphic_allocator<Buffer>{resource});
+    }
+
+    // Shared by all empty (default constructed and moved-from) data, so they don't allocate; it is copied before
+    // it would be changed, like any shared buffer
+    static const std::shared_ptr<Buffer>& emptyBuffer() {
+        static const auto buffer = allocate(nullptr);
+        return buffer;
+    }
+
     DataType dataType_;
     size_t componentCount_;
-    std::vector<uint8_t> data_;
+    // Declared before the buffer, so the arena outlives it
+    std::shared_ptr<Arena> arena_;
+    std::shared_ptr<Buffer> data_ = emptyBuffer();
 };
 
-template<class T>
-struct DataView {
+// Writes the components of the data converted to `dataType` to `out`, see TypedData::convert
+void convert(const TypedData& data, DataType dataType, bool normalized, void* out);
+
+// A non-owning view of typed data as elements of type T, which doesn't allocate. Data that is stored as T is read in
+// place; anything else (like U_SHORT indices viewed as uint32_t) is converted element by element as it is read, where
+// integers are widened, or with `Normalized` mapped to floats like normalized glTF accessors. The view refers to the
+// data, so it must outlive the view.
+template<class T, bool Normalized = false>
+class DataView {
+public:
     struct Iterator {
         using iterator_category = std::forward_iterator_tag;
         using difference_type = std::size_t;
@@ -299,14 +435,21 @@ struct DataView {
         using pointer = value_type*;
         using reference = value_type&;
 
-        Iterator(const T* start, difference_type index) : start_(start), index_(index) {}
+        Iterator() = default;
+
+        Iterator(const DataView* view, difference_type index) : view_(view), index_(index) {}
 
+        // Converted elements are held by the iterator, so the reference is valid until the iterator moves
         reference operator*() const {
-            return *(start_ + index_);
+            if (view_->contiguous_) {
+                return view_->contiguous_[index_];
+            }
+            value_ = (*view_)[index_];
+            return value_;
         }
 
-        pointer operator->() {
-            return start_ + index_;
+        pointer operator->() const {
+            return &**this;
         }
 
         Iterator& operator++() {
@@ -328,58 +471,87 @@ struct DataView {
         }
 
     private:
-        const T* start_;
-        difference_type index_;
+        const DataView* view_ = nullptr;
+        difference_type index_ = 0;
+        mutable T value_{};
     };
 
     using iterator = Iterator;
     using const_iterator = Iterator;
 
-    explicit DataView(const TypedData& data) : data_(data) {
-        // optimize for actual format
+    explicit DataView(const TypedData& data)
+        : data_(&data), convert_(detail::converter<T, Normalized>(data.dataType())), componentCount_(data.componentCount()) {
+        using C = detail::Component<T>;
+        const bool floating = data.dataType() == DataType::FLOAT || data.dataType() == DataType::DOUBLE;
         // TODO: check alignment
-        if (data.stride() != sizeof(T)) {
-            detail::Converter<T> converter;
-            view_ = transform<T>(data, [&](auto raw) { return converter(raw.begin(), data.componentCount(), data.componentSize()); });
+        if (data.stride() == sizeof(T) && data.componentSize() == sizeof(C) && floating == std::is_floating_point_v<C> &&
+            (!Normalized || floating)) {
+            contiguous_ = reinterpret_cast<const T*>(data.buffer().data());
         }
     }
 
     Iterator begin() const {
-        return view_.empty() ? Iterator{(T*) data_.buffer().data(), 0} : Iterator{view_.data(), 0};
+        return {this, 0};
     }
 
     Iterator end() const {
-        return view_.empty() ? Iterator{(T*) data_.buffer().data(), data_.size()} : Iterator{view_.data(), view_.size()};
+        return {this, size()};
     }
 
     size_t size() const {
-        return data_.size();
+        return data_->size();
     }
 
     size_t stride() const {
         return sizeof(T);
     }
 
-    const T& operator[](size_t pos) const {
-        return view_.empty() ? (T&) data_.buffer()[pos * data_.stride()] : view_[pos];
+    T operator[](size_t pos) const {
+        return contiguous_ ? contiguous_[pos] : convert_(data_->buffer().data() + pos * data_->stride(), componentCount_);
+    }
+
+    // The elements in place if they are stored as T, nullptr if they are converted
+    const T* contiguous() const {
+        return contiguous_;
     }
 
     void copyTo(void* out) const {
-        if (view_.empty()) {
-            data_.copyTo(out);
-        } else {
-            std::memcpy(out, view_.data(), view_.size() * sizeof(T));
+        if (contiguous_) {
+            data_->copyTo(out);
+            return;
+        }
+        using C = detail::Component<T>;
+        if (data_->componentCount() * sizeof(C) == sizeof(T)) {
+            // All components are converted at once
+            models::convert(*data_, toDataType<C>(), Normalized, out);
+            return;
+        }
+        auto* elements = static_cast<T*>(out);
+        for (size_t i = 0; i < size(); i++) {
+            elements[i] = (*this)[i];
         }
     }
 
+    // A converted copy, for when the elements are needed as T in one piece
+    std::vector<T> materialize() const {
+        std::vector<T> result(size());
+        copyTo(result.data());
+        return result;
+    }
+
     // TODO: weird naming
     const TypedData& data() const {
-        return data_;
+        return *data_;
     }
 
 private:
-    const TypedData& data_;
-    std::vector<T> view_;
+    const TypedData* data_;
+    const T* contiguous_ = nullptr;
+    detail::ConvertFn<T, Normalized> convert_;
+    size_t componentCount_;
 };
 
+template<class T>
+using NormalizedView = DataView<T, true>;
+
 } // namespace meshtools::models
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <meshtools/algorithm.hpp>
 #include <meshtools/image.hpp>
 #include <meshtools/math.hpp>
+#include <meshtools/models/arena.hpp>
 #include <meshtools/models/extras.hpp>
 #include <meshtools/models/material.hpp>
 #include <meshtools/models/mesh.hpp>
@@ -13,16 +14,24 @@
 #include <meshtools/result.hpp>
 
 #include <filesystem>
+#include <memory>
 #include <vector>
 
 namespace meshtools::models {
 
 using ModelLoadResult = Result<class Model>;
 
+// A mesh group placed in a scene by a node
+struct Instance {
+    size_t meshGroup;
+    glm::mat4 transform;
+};
+
 class Model {
 public:
-    static ModelLoadResult Load(const std::filesystem::path& path);
-    static ModelLoadResult Load(const std::string& contents, bool binary);
+    // With an arena, the geometry buffers are allocated from it, which makes loading and destroying big models cheap
+    static ModelLoadResult Load(const std::filesystem::path& path, std::shared_ptr<Arena> arena = nullptr);
+    static ModelLoadResult Load(const std::string& contents, bool binary, std::shared_ptr<Arena> arena = nullptr);
 
     Model(std::vector<MeshGroup> meshGroups, std::vector<Node> nodes, Extra extra = {});
 
@@ -89,31 +98,16 @@ public:
                         if (!applyLocalTransforms || cumulativeTransform == identity) {
                             meshes.emplace_back(orgMesh);
                         } else {
-                            TypedData indices{
-                                    orgMesh->indices().dataType(),
-                                    orgMesh->indices().componentCount(),
-                                    orgMesh->indices().buffer(),
-                            };
-
-                            VertexData vertexData;
-                            for (const auto& va : orgMesh->vertexData()) {
-                                vertexData[va.first] = {va.second.dataType(), va.second.componentCount(), va.second.buffer()};
-                            }
-
-                            // Transform positions
-                            DataView<glm::vec3> positions{vertexData[AttributeType::POSITION]};
-                            std::vector<glm::vec3> transformed;
-                            transformed.reserve(positions.size());
-                            for (auto& pos : positions) {
-                                transformed.emplace_back(cumulativeTransform * glm::vec4{pos, 1});
+                            // Only the positions change, everything else is shared with the original. They stay in
+                            // the arena of the original positions.
+                            auto mesh = std::make_shared<Mesh>(*orgMesh);
+                            const auto& positions = orgMesh->vertexAttribute(AttributeType::POSITION);
+                            auto transformed = DataView<glm::vec3>{positions}.materialize();
+                            for (auto& pos : transformed) {
+                                pos = cumulativeTransform * glm::vec4{pos, 1};
                             }
-                            vertexData[AttributeType::POSITION].copyFrom(transformed.data());
-
-                            meshes.emplace_back(std::make_shared<Mesh>(orgMesh->name(),
-                                                                       orgMesh->materialIdx(),
-                                                                       std::move(indices),
-                                                                       std::move(vertexData),
-                                                                       orgMesh->extra()));
+                            mesh->vertexAttribute(AttributeType::POSITION) = TypedData::From(DataType::FLOAT, 3, transformed, positions.arena());
+                            meshes.emplace_back(std::move(mesh));
                         }
                     }
                 }
@@ -123,6 +117,26 @@ public:
         return meshes;
     }
 
+    // All mesh group instances of a scene with their world transforms, in node order. Unlike meshes(), this does not copy
+    // any mesh data, so mesh groups that are referenced by many nodes can be shared by the consumer.
+    std::vector<Instance> instances(size_t scene, const glm::mat4& rootTransform = glm::mat4{1}) const {
+        assert(scene < scenes_.size());
+        std::vector<Instance> instances;
+        for (const auto& node : scenes_[scene]) {
+            node.visit(
+                    [&](const Node& node, const glm::mat4& parentTransform) {
+                        glm::mat4 transform = parentTransform * node.transform();
+                        if (node.mesh()) {
+                            assert(*node.mesh() < meshGroups_.size());
+                            instances.push_back({*node.mesh(), transform});
+                        }
+                        return transform;
+                    },
+                    rootTransform);
+        }
+        return instances;
+    }
+
     template<class MeshVisitor>
     void visit(const MeshVisitor& visitor) {
         for (auto& meshGroup : meshGroups_) {
@@ -184,6 +198,15 @@ public:
         return extra_;
     }
 
+    // The arena the geometry was loaded into, nullptr if it is on the heap
+    const std::shared_ptr<Arena>& arena() const {
+        return arena_;
+    }
+
+    void arena(std::shared_ptr<Arena> arena) {
+        arena_ = std::move(arena);
+    }
+
     void merge(const Model& model);
 
     void write(const std::filesystem::path& outFile) const;
@@ -200,6 +223,7 @@ private:
     std::vector<Texture> textures_;
     std::vector<Material> materials_;
     Extra extra_;
+    std::shared_ptr<Arena> arena_;
 };
 
 } // namespace meshtools::models
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <meshtools/models/attribute_type.hpp>
+#include <meshtools/models/mesh_data.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace meshtools::models {
+
+// The vertex attributes of a mesh, ordered by attribute id. Meshes have a handful of attributes, so a flat vector is
+// cheaper than a hash map, and attributes are visited in the same order for every mesh. The common attributes are
+// looked up through a table by id; only custom attributes are searched for.
+class VertexData {
+public:
+    using value_type = std::pair<AttributeType, TypedData>;
+    using iterator = std::vector<value_type>::iterator;
+    using const_iterator = std::vector<value_type>::const_iterator;
+
+    iterator begin() {
+        return entries_.begin();
+    }
+
+    iterator end() {
+        return entries_.end();
+    }
+
+    const_iterator begin() const {
+        return entries_.begin();
+    }
+
+    const_iterator end() const {
+        return entries_.end();
+    }
+
+    size_t size() const {
+        return entries_.size();
+    }
+
+    bool empty() const {
+        return entries_.empty();
+    }
+
+    iterator find(AttributeType attributeType) {
+        if (attributeType.id() < AttributeType::COMMON_COUNT) {
+            const auto slot = slots_[attributeType.id()];
+            return slot ? entries_.begin() + (slot - 1) : entries_.end();
+        }
+        auto it = position(attributeType);
+        return it != entries_.end() && it->first == attributeType ? it : entries_.end();
+    }
+
+    const_iterator find(AttributeType attributeType) const {
+        return const_cast<VertexData*>(this)->find(attributeType);
+    }
+
+    // Inserts empty data if the attribute is missing
+    TypedData& operator[](AttributeType attributeType) {
+        auto it = position(attributeType);
+        if (it == entries_.end() || it->first != attributeType) {
+            it = entries_.emplace(it, attributeType, TypedData{});
+            it = reindex(it);
+        }
+        return it->second;
+    }
+
+    // Does not replace existing data, like std::map
+    std::pair<iterator, bool> emplace(AttributeType attributeType, TypedData data) {
+        auto it = position(attributeType);
+        if (it != entries_.end() && it->first == attributeType) {
+            return {it, false};
+        }
+        return {reindex(entries_.emplace(it, attributeType, std::move(data))), true};
+    }
+
+    size_t erase(AttributeType attributeType) {
+        auto it = find(attributeType);
+        if (it == entries_.end()) {
+            return 0;
+        }
+        entries_.erase(it);
+        reindex(entries_.end());
+        return 1;
+    }
+
+private:
+    // The first entry that is not ordered before the attribute
+    iterator position(AttributeType attributeType) {
+        const auto id = attributeType.id();
+        if (id < AttributeType::COMMON_COUNT) {
+            // The attribute itself, or the entry after the closest common attribute before it
+            if (slots_[id]) {
+                return entries_.begin() + (slots_[id] - 1);
+            }
+            for (auto i = id; i > 0; i--) {
+                if (slots_[i - 1]) {
+                    return entries_.begin() + slots_[i - 1];
+                }
+            }
+            return entries_.begin();
+        }
+        return std::find_if(entries_.begin(), entries_.end(), [&](const value_type& entry) { return !(entry.first < attributeType); });
+    }
+
+    // Updates the table after an insert or erase has moved the entries, and returns `it`
+    iterator reindex(iterator it) {
+        slots_.fill(0);
+        for (size_t i = 0; i < entries_.size() && entries_[i].first.id() < AttributeType::COMMON_COUNT; i++) {
+            slots_[entries_[i].first.id()] = static_cast<uint8_t>(i + 1);
+        }
+        return it;
+    }
+
+    std::vector<value_type> entries_;
+    // One past the index of the entry of each common attribute, 0 if it is missing
+    std::array<uint8_t, AttributeType::COMMON_COUNT> slots_{};
+};
+
+} // namespace meshtools::models
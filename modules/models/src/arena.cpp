@@ -0,0 +1,50 @@
+#include <meshtools/models/arena.hpp>
+
+#include <algorithm>
+#include <cstddef>
+
+namespace meshtools::models {
+
+void* Arena::Upstream::do_allocate(size_t bytes, size_t alignment) {
+    allocated += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void Arena::Upstream::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    allocated -= bytes;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool Arena::Upstream::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+Arena::Arena(size_t initialSize) : resource_(initialSize, &upstream_) {}
+
+size_t Arena::footprint() const {
+    std::lock_guard lock(mutex_);
+    return upstream_.allocated;
+}
+
+size_t Arena::used() const {
+    std::lock_guard lock(mutex_);
+    return used_;
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+    // Byte buffers are viewed as floats and vectors in place, so everything gets the alignment of the heap
+    alignment = std::max(alignment, alignof(std::max_align_t));
+    std::lock_guard lock(mutex_);
+    used_ += bytes;
+    return resource_.allocate(bytes, alignment);
+}
+
+void Arena::do_deallocate(void*, size_t, size_t) {
+    // Released with the arena
+}
+
+bool Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+} // namespace meshtools::models
@@ -1,10 +1,80 @@
 #include <meshtools/models/attribute_type.hpp>
 
+#include <array>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
 namespace meshtools::models {
 
-const AttributeType AttributeType::POSITION{"POSITION"};
-const AttributeType AttributeType::NORMAL{"NORMAL"};
-const AttributeType AttributeType::TEXCOORD{"TEXCOORD_0"};
-const AttributeType AttributeType::COLOR{"COLOR_0"};
+namespace {
+
+// Attributes of the glTF spec, with the sets that are common in practice
+const constexpr std::array<std::string_view, AttributeType::COMMON_COUNT> COMMON{
+        "POSITION", "NORMAL",  "TANGENT", "TEXCOORD_0", "TEXCOORD_1", "TEXCOORD_2", "TEXCOORD_3", "COLOR_0",
+        "COLOR_1",  "COLOR_2", "COLOR_3", "JOINTS_0",   "JOINTS_1",   "WEIGHTS_0",  "WEIGHTS_1",
+};
+
+constexpr uint32_t commonId(std::string_view name) {
+    for (uint32_t id = 0; id < COMMON.size(); id++) {
+        if (COMMON[id] == name) {
+            return id;
+        }
+    }
+    return COMMON.size();
+}
+
+// The names of all ids, shared by all threads. Names are never removed, so references to them stay valid.
+struct Names {
+    Names() {
+        for (auto name : COMMON) {
+            add(name);
+        }
+    }
+
+    uint32_t add(std::string_view name) {
+        const auto& stored = names.emplace_back(name);
+        return ids.emplace(stored, names.size() - 1).first->second;
+    }
+
+    std::shared_mutex mutex;
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, uint32_t> ids;
+};
+
+Names& names() {
+    static Names names;
+    return names;
+}
+
+} // namespace
+
+const AttributeType AttributeType::POSITION{commonId("POSITION")};
+const AttributeType AttributeType::NORMAL{commonId("NORMAL")};
+const AttributeType AttributeType::TEXCOORD{commonId("TEXCOORD_0")};
+const AttributeType AttributeType::COLOR{commonId("COLOR_0")};
+
+AttributeType::AttributeType(std::string_view name) {
+    auto& table = names();
+    {
+        std::shared_lock lock(table.mutex);
+        auto it = table.ids.find(name);
+        if (it != table.ids.end()) {
+            id_ = it->second;
+            return;
+        }
+    }
+
+    std::unique_lock lock(table.mutex);
+    auto it = table.ids.find(name);
+    id_ = it != table.ids.end() ? it->second : table.add(name);
+}
+
+const std::string& AttributeType::name() const {
+    auto& table = names();
+    std::shared_lock lock(table.mutex);
+    return table.names[id_];
+}
 
-} // namespace meshtools::models
\ No newline at end of file
+} // namespace meshtools::models
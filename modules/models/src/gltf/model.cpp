@@ -2,9 +2,11 @@
 
 #include <meshtools/algorithm.hpp>
 #include <meshtools/logging.hpp>
+#include <meshtools/parallel.hpp>
 #include <meshtools/string.hpp>
 
 #define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE
 #define TINYGLTF_NO_STB_IMAGE_WRITE
 #define TINYGLTF_USE_CPP14
 #define TINYGLTF_ENABLE_DRACO
@@ -98,9 +100,24 @@ models::Extra fromValue(const tinygltf::Value& value) {
     return {std::monostate()};
 }
 
-// Stub
-bool loadImageDataFunction(tinygltf::Image*, const int, std::string*, std::string*, int, int, const unsigned char*, int,
-                           void* user_pointer) {
+// Keeps the images encoded instead of decoding them; only their headers are read
+bool loadImageDataFunction(tinygltf::Image* image, const int imageIdx, std::string* err, std::string*, int, int,
+                           const unsigned char* bytes, int size, void*) {
+    auto encoded = Image::Encoded(std::vector<uint8_t>(bytes, bytes + size));
+    if (!encoded) {
+        if (err) {
+            *err += "Image " + std::to_string(imageIdx) + ": " + encoded.error + "\n";
+        }
+        return false;
+    }
+
+    image->width = static_cast<int>(encoded->width());
+    image->height = static_cast<int>(encoded->height());
+    image->component = encoded->channels();
+    image->bits = 8;
+    image->pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+    image->mimeType = encoded->mimeType();
+    image->image = std::move(encoded->data());
     return true;
 }
 
@@ -162,7 +179,7 @@ meshtools::models::AttributeType attributeType(const std::string& input) {
 }
 
 std::string attributeType(const meshtools::models::AttributeType& input) {
-    return input.name;
+    return input.name();
 }
 
 constexpr size_t componentCount(const tinygltf::Accessor& accessor) {
@@ -252,7 +269,8 @@ struct BufferRange {
     }
 };
 
-BufferRange appendToBuffer(tinygltf::Buffer& buffer, const std::vector<unsigned char>& data) {
+template<class Bytes>
+BufferRange appendToBuffer(tinygltf::Buffer& buffer, const Bytes& data) {
     auto startIdx = buffer.data.size();
     buffer.data.insert(buffer.data.end(), data.begin(), data.end());
 
@@ -324,7 +342,8 @@ void parseNodes(const tinygltf::Model& gltfModel, Model& model) {
     }
 }
 
-TypedData parseAccessor(const tinygltf::Model& gltfModel, int accessor) {
+// The data is allocated from the arena of the model, if it has one
+TypedData parseAccessor(const tinygltf::Model& gltfModel, int accessor, const std::shared_ptr<Arena>& arena) {
     const auto& gltfAccessor = gltfModel.accessors[accessor];
     const auto& gltfBufferView = gltfModel.bufferViews[gltfAccessor.bufferView];
     const auto& gltfBuffer = gltfModel.buffers[gltfBufferView.buffer];
@@ -335,66 +354,58 @@ TypedData parseAccessor(const tinygltf::Model& gltfModel, int accessor) {
     const auto compCnt = componentCount(gltfAccessor);
     const auto attributeSize = compByteSize * compCnt;
 
-    std::vector<unsigned char> result;
+    TypedData result(type, compCnt, gltfAccessor.count, arena);
 
+    // Start of the buffer
+    const auto start = gltfBuffer.data.data() + gltfBufferView.byteOffset + gltfAccessor.byteOffset;
     if ((gltfBufferView.byteStride == 0 || gltfBufferView.byteStride == attributeSize)) {
         // De-interlaced buffer, straight up copy
-        result.resize(gltfBufferView.byteLength);
-        std::memcpy(result.data(), gltfBuffer.data.data() + gltfBufferView.byteOffset + gltfAccessor.byteOffset, gltfBufferView.byteLength);
+        result.copyFrom(start);
     } else {
         // Need to parse the buffer
-        result.reserve(gltfBufferView.byteLength);
-
-        // Start of the buffer
-        const auto start = gltfBuffer.data.data() + gltfBufferView.byteOffset + gltfAccessor.byteOffset;
-        const auto stride = gltfBufferView.byteStride > 0 ? gltfBufferView.byteStride : attributeSize;
+        const auto stride = gltfBufferView.byteStride;
         for (size_t i = 0; i < gltfAccessor.count; i++) {
-            std::copy_n(start + i * stride, compByteSize, std::back_inserter(result));
+            std::memcpy(result[i].begin(), start + i * stride, attributeSize);
         }
     }
 
-    return TypedData{
-            type,
-            compCnt,
-            std::move(result),
-    };
+    return result;
 }
 
 template<class Fn>
 TypedData parseAttributeOr(const tinygltf::Model& gltfModel, const tinygltf::Primitive& gltfPrimitive, const std::string& attribute,
-                           Fn&& orFn) {
+                           const std::shared_ptr<Arena>& arena, Fn&& orFn) {
     auto it = gltfPrimitive.attributes.find(attribute);
     if (it == gltfPrimitive.attributes.end()) {
         return orFn();
     }
 
-    return parseAccessor(gltfModel, it->second);
+    return parseAccessor(gltfModel, it->second, arena);
 };
 
 std::shared_ptr<Mesh> parsePrimitive(const tinygltf::Model& gltfModel, const tinygltf::Mesh& gltfMesh,
-                                     const tinygltf::Primitive& gltfPrimitive) {
+                                     const tinygltf::Primitive& gltfPrimitive, const std::shared_ptr<Arena>& arena) {
     // Parse vertex attributes
     VertexData vertexData;
     for (const auto& attribute : gltfPrimitive.attributes) {
-        vertexData.emplace(attributeType(attribute.first), parseAccessor(gltfModel, attribute.second));
+        vertexData.emplace(attributeType(attribute.first), parseAccessor(gltfModel, attribute.second, arena));
     }
 
     // Parse indices
     auto indices = [&]() {
         if (gltfPrimitive.indices >= 0) {
-            return parseAccessor(gltfModel, gltfPrimitive.indices);
+            return parseAccessor(gltfModel, gltfPrimitive.indices, arena);
         } else {
             // Generate indices
             logging::warn("No indices in primitive, generating");
             assert(vertexData.find(AttributeType::POSITION) != vertexData.end());
             assert(vertexData[AttributeType::POSITION].size() % 3 == 0);
             auto positionCount = vertexData[AttributeType::POSITION].size();
-            std::vector<uint32_t> ib;
-            ib.reserve(positionCount);
+            TypedData ib(DataType::U_INT, 1, positionCount, arena);
             for (uint32_t i = 0; i < positionCount; i++) {
-                ib.push_back(i);
+                std::memcpy(ib[i].begin(), &i, sizeof(i));
             }
-            return TypedData{DataType::U_INT, 1, std::vector<unsigned char>{}};
+            return ib;
         }
     }();
 
@@ -405,14 +416,14 @@ std::shared_ptr<Mesh> parsePrimitive(const tinygltf::Model& gltfModel, const tin
                                   fromValue(gltfPrimitive.extras));
 }
 
-MeshGroup parseMesh(const tinygltf::Model& gltfModel, const tinygltf::Mesh& gltfMesh) {
+MeshGroup parseMesh(const tinygltf::Model& gltfModel, const tinygltf::Mesh& gltfMesh, const std::shared_ptr<Arena>& arena) {
 
     std::vector<std::shared_ptr<Mesh>> meshes;
     meshes.reserve(gltfMesh.primitives.size());
     std::transform(gltfMesh.primitives.begin(),
                    gltfMesh.primitives.end(),
                    std::back_inserter(meshes),
-                   [&](const tinygltf::Primitive& gltfPrimitive) { return parsePrimitive(gltfModel, gltfMesh, gltfPrimitive); });
+                   [&](const tinygltf::Primitive& gltfPrimitive) { return parsePrimitive(gltfModel, gltfMesh, gltfPrimitive, arena); });
 
     return {
             gltfMesh.name,
@@ -425,20 +436,32 @@ void parseMeshes(const tinygltf::Model& gltfModel, Model& model) {
     model.meshGroups().reserve(gltfModel.meshes.size());
 
     for (const auto& gltfMesh : gltfModel.meshes) {
-        model.meshGroups().emplace_back(parseMesh(gltfModel, gltfMesh));
+        model.meshGroups().emplace_back(parseMesh(gltfModel, gltfMesh, model.arena()));
     }
 }
 
-void parseImages(const tinygltf::Model& gltfModel, Model& model) {
-    model.images() = transform<std::shared_ptr<Image>>(gltfModel.images, [](const tinygltf::Image& image) {
-        auto img = std::make_shared<Image>(static_cast<uint32_t>(image.height),
-                                           static_cast<uint32_t>(image.height),
-                                           static_cast<uint8_t>(image.component));
+// The type of an encoded image, from the mime type that loadImageDataFunction sniffed from its data
+Image::Type imageType(const std::string& mimeType) {
+    if (mimeType == "image/png") {
+        return Image::Type::PNG;
+    } else if (mimeType == "image/ktx2") {
+        return Image::Type::KTX2;
+    }
+    return Image::Type::JPG;
+}
 
-        img->data() = image.image;
+// Images are still encoded (see loadImageDataFunction), their bytes are moved out of the glTF model
+void parseImages(tinygltf::Model& gltfModel, Model& model) {
+    model.images().reserve(gltfModel.images.size());
+    for (auto& image : gltfModel.images) {
+        auto img = std::make_shared<Image>(static_cast<uint32_t>(image.width),
+                                           static_cast<uint32_t>(image.height),
+                                           static_cast<uint8_t>(image.component),
+                                           imageType(image.mimeType),
+                                           std::move(image.image));
         img->name() = image.name;
-        return img;
-    });
+        model.images().push_back(std::move(img));
+    }
 }
 
 void parseSamplers(const tinygltf::Model& gltfModel, Model& model) {
@@ -454,9 +477,15 @@ void parseSamplers(const tinygltf::Model& gltfModel, Model& model) {
 
 void parseTextures(const tinygltf::Model& gltfModel, Model& model) {
     model.textures() = transform<Texture>(gltfModel.textures, [](const tinygltf::Texture& texture) {
+        // KTX2 images without a fallback are only referenced by the extension
+        auto source = texture.source;
+        auto basisu = texture.extensions.find("KHR_texture_basisu");
+        if (source < 0 && basisu != texture.extensions.end() && basisu->second.Has("source")) {
+            source = basisu->second.Get("source").GetNumberAsInt();
+        }
         return Texture{
                 texture.sampler,
-                texture.source,
+                source,
         };
     });
 }
@@ -601,28 +630,29 @@ tinygltf::Model encode(const Model& model) {
     }
 
     if (!model.images().empty()) {
-        // Images
-        for (auto& image : model.images()) {
-            Image::Type type;
-            std::vector<uint8_t> imageData;
-            if (image->type() == Image::Type::RAW) {
-                if (image->channels() == 4) {
-                    imageData = std::move(image->png().data());
-                    type = Image::Type::PNG;
-                } else {
-                    imageData = std::move(image->jpg().data());
-                    type = Image::Type::JPG;
-                }
-            } else {
-                imageData = image->data();
-                type = image->type();
+        // Images; raw ones are encoded concurrently, sharing the threads between them. Encoded ones are written as
+        // they were loaded.
+        const auto& images = model.images();
+        std::vector<std::shared_ptr<Image>> encodedImages(images.size());
+        const auto threadsPerImage = std::max<size_t>(1, parallel::concurrency() / images.size());
+        parallel::forEach(images.size(), 0, [&](size_t imageIdx, size_t) {
+            const auto& image = images[imageIdx];
+            if (image->type() != Image::Type::RAW) {
+                return;
             }
+            encodedImages[imageIdx] = std::make_shared<Image>(image->channels() == 4 ? image->png(threadsPerImage) : image->jpg());
+        });
+
+        for (size_t imageIdx = 0; imageIdx < images.size(); imageIdx++) {
+            const auto& image = images[imageIdx];
+            const auto& encoded = encodedImages[imageIdx] ? *encodedImages[imageIdx] : *image;
+            const auto& imageData = encoded.data();
 
             tinygltf::Image gltfImage{};
             gltfImage.width = image->width();
             gltfImage.height = image->height();
             gltfImage.component = image->channels();
-            gltfImage.mimeType = type == Image::Type::PNG ? "image/png" : "image/jpeg";
+            gltfImage.mimeType = encoded.mimeType();
 
             auto imageBufferRange = appendToBuffer(buffer, imageData);
             auto bufferViewIndex = addBufferView(gltfModel, buffer, imageBufferRange);
@@ -648,10 +678,15 @@ tinygltf::Model encode(const Model& model) {
             gltfModel.samplers.emplace_back(gltfSampler);
         }
 
-        // Textures
+        // Textures; KTX2 images can only be referenced through KHR_texture_basisu
         for (auto& texture : model.textures()) {
             tinygltf::Texture gltfSampler{};
-            gltfSampler.source = texture.source;
+            if (texture.source >= 0 && static_cast<size_t>(texture.source) < images.size() &&
+                images[texture.source]->type() == Image::Type::KTX2) {
+                gltfSampler.extensions["KHR_texture_basisu"] = toValue(Extras{{{"source", texture.source}}});
+            } else {
+                gltfSampler.source = texture.source;
+            }
             gltfSampler.sampler = texture.sampler;
             gltfModel.textures.emplace_back(gltfSampler);
         }
@@ -687,16 +722,23 @@ tinygltf::Model encode(const Model& model) {
         })) {
         gltfModel.extensionsUsed.emplace_back("EXT_mesh_features");
     }
+    if (std::any_of(gltfModel.textures.begin(), gltfModel.textures.end(), [](const tinygltf::Texture& texture) {
+            return texture.extensions.count("KHR_texture_basisu") > 0;
+        })) {
+        // There is no fallback image
+        gltfModel.extensionsUsed.emplace_back("KHR_texture_basisu");
+        gltfModel.extensionsRequired.emplace_back("KHR_texture_basisu");
+    }
 
     return gltfModel;
 }
 
 // Public API //
 
-ModelLoadResult LoadModel(const std::string& contents, bool binary) {
+ModelLoadResult LoadModel(const std::string& contents, bool binary, std::shared_ptr<Arena> arena) {
     tinygltf::Model gltfModel;
     tinygltf::TinyGLTF loader;
-    //    loader.SetImageLoader(&loadImageDataFunction, nullptr);
+    loader.SetImageLoader(&loadImageDataFunction, nullptr);
     loader.SetImageWriter(&writeImageDataFunction, nullptr);
 
     std::string err;
@@ -723,6 +765,7 @@ ModelLoadResult LoadModel(const std::string& contents, bool binary) {
     }
 
     auto model = std::make_shared<Model>();
+    model->arena(std::move(arena));
 
     parseImages(gltfModel, *model);
     parseSamplers(gltfModel, *model);
@@ -734,11 +777,11 @@ ModelLoadResult LoadModel(const std::string& contents, bool binary) {
     return {std::move(model)};
 }
 
-ModelLoadResult LoadModel(const std::filesystem::path& file) {
+ModelLoadResult LoadModel(const std::filesystem::path& file, std::shared_ptr<Arena> arena) {
 
     tinygltf::Model gltfModel;
     tinygltf::TinyGLTF loader;
-    //    loader.SetImageLoader(&loadImageDataFunction, nullptr);
+    loader.SetImageLoader(&loadImageDataFunction, nullptr);
     loader.SetImageWriter(&writeImageDataFunction, nullptr);
 
     std::string err;
@@ -763,6 +806,7 @@ ModelLoadResult LoadModel(const std::filesystem::path& file) {
     }
 
     auto model = std::make_shared<Model>();
+    model->arena(std::move(arena));
 
     parseImages(gltfModel, *model);
     parseSamplers(gltfModel, *model);
@@ -3,13 +3,14 @@
 #include <meshtools/models/model.hpp>
 
 #include <filesystem>
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace meshtools::models::gltf {
 
-ModelLoadResult LoadModel(const std::filesystem::path& file);
-ModelLoadResult LoadModel(const std::string& contents, bool binary);
+ModelLoadResult LoadModel(const std::filesystem::path& file, std::shared_ptr<Arena> arena);
+ModelLoadResult LoadModel(const std::string& contents, bool binary, std::shared_ptr<Arena> arena);
 
 std::string text(const Model&);
 
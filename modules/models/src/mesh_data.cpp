@@ -0,0 +1,180 @@
+#include <meshtools/models/mesh_data.hpp>
+
+#include <meshtools/simd.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace meshtools::models {
+
+namespace {
+
+// simd::WIDTH components of type T (an alias template would drop the attribute)
+template<class T>
+struct VectorOf {
+    typedef T type __attribute__((vector_size(simd::WIDTH * sizeof(T))));
+};
+
+template<class T>
+using Vector = typename VectorOf<T>::type;
+
+// Lane-wise mask ? a : b, for vectors of any element type (see simd::select)
+template<class V, class M>
+[[gnu::always_inline]] inline V select(const M& mask, const V& a, const V& b) {
+    return (V) (((M) a & mask) | ((M) b & ~mask));
+}
+
+// The range of D as values of S. The largest integers of 32 bits and up round up to the next power of two as floats,
+// which would overflow, so the limit is the largest float below that.
+template<class D, class S>
+S upperLimit() {
+    auto limit = static_cast<S>(std::numeric_limits<D>::max());
+    if (static_cast<long double>(limit) > static_cast<long double>(std::numeric_limits<D>::max())) {
+        limit = std::nextafter(limit, S{0});
+    }
+    return limit;
+}
+
+template<class D, class S>
+S lowerLimit() {
+    return static_cast<S>(std::numeric_limits<D>::lowest());
+}
+
+// Converts `count` components of type S to D, simd::WIDTH at a time. Integers that are converted to floats are
+// normalized if asked for (in double precision for doubles); it has no effect on other pairs of types. Floats that are
+// converted to integers are clamped to the range of the integer type, and NaN becomes 0.
+template<class D, class S, bool Normalized>
+[[gnu::always_inline]] inline void convertComponents(const uint8_t* src, uint8_t* dst, size_t count) {
+    constexpr bool normalize = Normalized && std::is_integral_v<S> && std::is_floating_point_v<D>;
+    constexpr bool clamp = std::is_floating_point_v<S> && std::is_integral_v<D>;
+    using Real = std::conditional_t<std::is_same_v<D, double>, double, float>;
+    constexpr Real scale = Real{1} / static_cast<Real>(std::numeric_limits<S>::max());
+    S lower{};
+    S upper{};
+    if constexpr (clamp) {
+        lower = lowerLimit<D, S>();
+        upper = upperLimit<D, S>();
+    }
+
+    size_t i = 0;
+    for (; i + simd::WIDTH <= count; i += simd::WIDTH) {
+        Vector<S> source;
+        std::memcpy(&source, src + i * sizeof(S), sizeof(source));
+        Vector<D> result;
+        if constexpr (normalize) {
+            auto value = __builtin_convertvector(source, Vector<Real>) * scale;
+            if constexpr (std::is_signed_v<S>) {
+                // The smallest value is -1 as well
+                const auto minusOne = Vector<Real>{} - Real{1};
+                value = select(value < minusOne, minusOne, value);
+            }
+            result = __builtin_convertvector(value, Vector<D>);
+        } else if constexpr (clamp) {
+            const auto zero = Vector<S>{};
+            const auto lowerVector = zero + lower;
+            const auto upperVector = zero + upper;
+            source = select(source == source, source, zero);
+            source = select(source < lowerVector, lowerVector, source);
+            source = select(source > upperVector, upperVector, source);
+            result = __builtin_convertvector(source, Vector<D>);
+        } else {
+            result = __builtin_convertvector(source, Vector<D>);
+        }
+        std::memcpy(dst + i * sizeof(D), &result, sizeof(result));
+    }
+
+    for (; i < count; i++) {
+        S source;
+        std::memcpy(&source, src + i * sizeof(S), sizeof(S));
+        D result;
+        if constexpr (normalize) {
+            result = static_cast<D>(std::max(static_cast<Real>(source) * scale, Real{-1}));
+        } else if constexpr (clamp) {
+            result = source == source ? static_cast<D>(std::clamp(source, lower, upper)) : D{0};
+        } else {
+            result = static_cast<D>(source);
+        }
+        std::memcpy(dst + i * sizeof(D), &result, sizeof(D));
+    }
+}
+
+template<class S, bool Normalized>
+[[gnu::always_inline]] inline void convertFrom(DataType to, const uint8_t* src, uint8_t* dst, size_t count) {
+    switch (to) {
+        case DataType::BYTE:
+            return convertComponents<int8_t, S, Normalized>(src, dst, count);
+        case DataType::U_BYTE:
+            return convertComponents<uint8_t, S, Normalized>(src, dst, count);
+        case DataType::SHORT:
+            return convertComponents<int16_t, S, Normalized>(src, dst, count);
+        case DataType::U_SHORT:
+            return convertComponents<uint16_t, S, Normalized>(src, dst, count);
+        case DataType::INT:
+            return convertComponents<int32_t, S, Normalized>(src, dst, count);
+        case DataType::U_INT:
+            return convertComponents<uint32_t, S, Normalized>(src, dst, count);
+        case DataType::FLOAT:
+            return convertComponents<float, S, Normalized>(src, dst, count);
+        case DataType::DOUBLE:
+            return convertComponents<double, S, Normalized>(src, dst, count);
+        case DataType::UNKNOWN:
+            assert(false);
+    }
+}
+
+template<bool Normalized>
+[[gnu::always_inline]] inline void convert(DataType from, DataType to, const uint8_t* src, uint8_t* dst, size_t count) {
+    switch (from) {
+        case DataType::BYTE:
+            return convertFrom<int8_t, Normalized>(to, src, dst, count);
+        case DataType::U_BYTE:
+            return convertFrom<uint8_t, Normalized>(to, src, dst, count);
+        case DataType::SHORT:
+            return convertFrom<int16_t, Normalized>(to, src, dst, count);
+        case DataType::U_SHORT:
+            return convertFrom<uint16_t, Normalized>(to, src, dst, count);
+        case DataType::INT:
+            return convertFrom<int32_t, Normalized>(to, src, dst, count);
+        case DataType::U_INT:
+            return convertFrom<uint32_t, Normalized>(to, src, dst, count);
+        case DataType::FLOAT:
+            return convertFrom<float, Normalized>(to, src, dst, count);
+        case DataType::DOUBLE:
+            return convertFrom<double, Normalized>(to, src, dst, count);
+        case DataType::UNKNOWN:
+            assert(false);
+    }
+}
+
+// All kernels are inlined here, so they are built for every instruction set
+MESHTOOLS_TARGET_CLONES
+void convertBuffer(DataType from, DataType to, bool normalized, const uint8_t* src, uint8_t* dst, size_t count) {
+    if (normalized) {
+        convert<true>(from, to, src, dst, count);
+    } else {
+        convert<false>(from, to, src, dst, count);
+    }
+}
+
+} // namespace
+
+void convert(const TypedData& data, DataType dataType, bool normalized, void* out) {
+    if (data.dataType() == dataType) {
+        data.copyTo(out);
+        return;
+    }
+    const auto count = data.size() * data.componentCount();
+    convertBuffer(data.dataType(), dataType, normalized, data.buffer().data(), static_cast<uint8_t*>(out), count);
+}
+
+TypedData TypedData::convert(DataType dataType, bool normalized) const {
+    TypedData result(dataType, componentCount_, size(), arena_);
+    models::convert(*this, dataType, normalized, result.data_->data());
+    return result;
+}
+
+} // namespace meshtools::models
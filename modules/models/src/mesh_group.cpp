@@ -48,7 +48,8 @@ void MeshGroup::merge(bool discardMaterials) {
     // TODO: Check if all indices are the same type
     bool indices16bit = meshes_[0]->indices().dataType() == DataType::U_SHORT;
 
-    std::vector<std::shared_ptr<Mesh>> result{meshes_[0]};
+    // Meshes are appended to copies, which share the buffers of the original until then
+    std::vector<std::shared_ptr<Mesh>> result{std::make_shared<Mesh>(*meshes_[0])};
     Mesh* accumulator = &*result[0];
     for (size_t i = 1; i < meshes_.size(); i++) {
         auto& mesh = meshes_[i];
@@ -57,7 +58,7 @@ void MeshGroup::merge(bool discardMaterials) {
 
         // Check we're not exceeding 16 bit index limit
         if (indices16bit && offset + positionCount > std::numeric_limits<uint16_t>::max()) {
-            accumulator = &*result.emplace_back(mesh);
+            accumulator = &*result.emplace_back(std::make_shared<Mesh>(*mesh));
             continue;
         }
 
@@ -27,12 +27,12 @@ Model::Model() = default;
 
 Model::~Model() = default;
 
-ModelLoadResult Model::Load(const std::filesystem::path& path) {
-    auto loadModel = [](const auto& path) -> ModelLoadResult {
+ModelLoadResult Model::Load(const std::filesystem::path& path, std::shared_ptr<Arena> arena) {
+    auto loadModel = [&arena](const auto& path) -> ModelLoadResult {
         if (string::endsWith(path.string(), ".obj")) {
-            return obj::loadModel(path);
+            return obj::loadModel(path, std::move(arena));
         } else if (string::endsWith(path.string(), ".gltf") || string::endsWith(path.string(), ".glb")) {
-            return gltf::LoadModel(path);
+            return gltf::LoadModel(path, std::move(arena));
         }
 
         return ModelLoadResult{std::string{"Unknown model format: "} + path.c_str()};
@@ -47,8 +47,8 @@ ModelLoadResult Model::Load(const std::filesystem::path& path) {
     return loadResult;
 }
 
-ModelLoadResult Model::Load(const std::string& contents, bool binary) {
-    auto loadResult = gltf::LoadModel(contents, binary);
+ModelLoadResult Model::Load(const std::string& contents, bool binary, std::shared_ptr<Arena> arena) {
+    auto loadResult = gltf::LoadModel(contents, binary, std::move(arena));
 
     if (!loadResult) {
         logging::error("Could not load model {}", loadResult.error);
@@ -89,15 +89,16 @@ void Model::merge(const Model& model) {
     // Meshes
     auto meshOffset = meshGroups_.size();
     for (auto& meshGroup : model.meshGroups()) {
-        // TODO: Copy meshes?
-        auto& meshGroupNew = meshGroups_.emplace_back(meshGroup.name(), meshGroup.meshes(), meshGroup.extra());
-
-        // Update material references
-        for (auto& mesh : meshGroupNew.meshes()) {
-            if (mesh->materialIdx() > -1) {
-                mesh->materialIdx(mesh->materialIdx() + materialOffset);
+        // The meshes are copied (sharing their buffers) so the material references of the other model stay untouched
+        std::vector<std::shared_ptr<Mesh>> meshes;
+        meshes.reserve(meshGroup.meshes().size());
+        for (const auto& mesh : meshGroup.meshes()) {
+            auto& meshNew = meshes.emplace_back(std::make_shared<Mesh>(*mesh));
+            if (meshNew->materialIdx() > -1) {
+                meshNew->materialIdx(meshNew->materialIdx() + materialOffset);
             }
         }
+        meshGroups_.emplace_back(meshGroup.name(), std::move(meshes), meshGroup.extra());
     }
 
     // Nodes
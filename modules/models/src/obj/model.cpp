@@ -9,19 +9,16 @@
 
 namespace meshtools::models::obj {
 
-template<class B, class A>
-std::vector<B> copy(const std::vector<A>& a) {
-    if (a.empty()) {
-        return {};
+template<class A>
+TypedData copy(size_t componentCount, const std::vector<A>& a, const std::shared_ptr<Arena>& arena) {
+    TypedData b(toDataType<A>(), componentCount, a.size() / componentCount, arena);
+    if (!a.empty()) {
+        b.copyFrom(a.data());
     }
-    std::vector<B> b(a.size() * sizeof(A) / sizeof(B));
-
-    memcpy(b.data(), a.data(), a.size() * sizeof(A));
-
     return b;
 }
 
-ModelLoadResult loadModel(const std::filesystem::path& file) {
+ModelLoadResult loadModel(const std::filesystem::path& file, std::shared_ptr<Arena> arena) {
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
     std::string error;
@@ -39,18 +36,19 @@ ModelLoadResult loadModel(const std::filesystem::path& file) {
     meshes.reserve(shapes.size());
     for (auto& shape : shapes) {
         VertexData vertexData;
-        vertexData[AttributeType::POSITION] = TypedData{DataType::FLOAT, 3, copy<unsigned char>(shape.mesh.positions)};
-        vertexData[AttributeType::NORMAL] = TypedData{DataType::FLOAT, 3, copy<unsigned char>(shape.mesh.normals)};
-        vertexData[AttributeType::TEXCOORD] = TypedData{DataType::FLOAT, 2, copy<unsigned char>(shape.mesh.texcoords)};
+        vertexData[AttributeType::POSITION] = copy(3, shape.mesh.positions, arena);
+        vertexData[AttributeType::NORMAL] = copy(3, shape.mesh.normals, arena);
+        vertexData[AttributeType::TEXCOORD] = copy(2, shape.mesh.texcoords, arena);
 
         auto mesh = std::make_shared<Mesh>(shape.name,
                                            -1, // TODO: Material
-                                           TypedData{DataType::U_INT, 1, copy<unsigned char>(shape.mesh.indices)},
+                                           copy(1, shape.mesh.indices, arena),
                                            std::move(vertexData));
         meshes.emplace_back(shape.name, std::move(mesh), Extra{});
     }
 
     result.value = std::make_shared<Model>(std::move(meshes));
+    result.value->arena(std::move(arena));
     return result;
 }
 
@@ -4,9 +4,10 @@
 #include <meshtools/models/model.hpp>
 
 #include <filesystem>
+#include <memory>
 
 namespace meshtools::models::obj {
 
-ModelLoadResult loadModel(const std::filesystem::path& filename);
+ModelLoadResult loadModel(const std::filesystem::path& filename, std::shared_ptr<Arena> arena);
 
 } // namespace meshtools::models::obj
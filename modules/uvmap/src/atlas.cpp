@@ -5,8 +5,24 @@
 
 #include <xatlas.h>
 
+#include <utility>
+
 namespace meshtools::uv {
 
+namespace {
+
+// xatlas reads floats in place; attributes that are stored differently are converted into `storage` first
+template<class T, bool Normalized>
+const T* floats(const models::DataView<T, Normalized>& view, std::vector<T>& storage) {
+    if (view.contiguous()) {
+        return view.contiguous();
+    }
+    storage = view.materialize();
+    return storage.data();
+}
+
+} // namespace
+
 class Atlas::Impl {
 public:
     Impl() {
@@ -32,18 +48,20 @@ Result<Atlas> Atlas::Create(const std::vector<std::shared_ptr<models::Mesh>>& me
     uint32_t totalVertices = 0, totalFaces = 0;
     for (const auto& mesh : meshes) {
         xatlas::MeshDecl meshDecl;
+        std::vector<glm::vec3> positions, normals;
+        std::vector<glm::vec2> uvs;
         auto positionsView = mesh->vertexAttribute<glm::vec3>(models::AttributeType::POSITION);
         meshDecl.vertexCount = (uint32_t) positionsView.size();
-        meshDecl.vertexPositionData = &*positionsView.begin();
+        meshDecl.vertexPositionData = floats(positionsView, positions);
         meshDecl.vertexPositionStride = positionsView.stride();
         if (mesh->hasVertexAttribute(models::AttributeType::NORMAL)) {
             auto normalsView = mesh->vertexAttribute<glm::vec3>(models::AttributeType::NORMAL);
-            meshDecl.vertexNormalData = &*normalsView.begin();
+            meshDecl.vertexNormalData = floats(normalsView, normals);
             meshDecl.vertexNormalStride = normalsView.stride();
         }
         if (mesh->hasVertexAttribute(models::AttributeType::TEXCOORD)) {
-            auto uvsView = mesh->vertexAttribute<glm::vec2>(models::AttributeType::TEXCOORD);
-            meshDecl.vertexUvData = &*uvsView.begin();
+            models::NormalizedView<glm::vec2> uvsView{mesh->vertexAttribute(models::AttributeType::TEXCOORD)};
+            meshDecl.vertexUvData = floats(uvsView, uvs);
             meshDecl.vertexUvStride = uvsView.stride();
         }
 
@@ -94,22 +112,31 @@ void Atlas::apply(std::vector<std::shared_ptr<models::Mesh>>& meshes) {
         auto& modelMesh = meshes[i];
 
         // Update all vertex attributes (except Texcoords)
-        std::unordered_map<models::AttributeType, models::TypedData> vertexData;
-        for (auto key : modelMesh->vertexAttributes()) {
-            if (key == models::AttributeType::TEXCOORD) {
+        models::VertexData vertexData;
+        for (const auto& va : std::as_const(*modelMesh).vertexData()) {
+            if (va.first == models::AttributeType::TEXCOORD) {
                 continue;
             }
-            auto& org = modelMesh->vertexAttribute(key);
-            vertexData[key] = {org.dataType(), org.componentCount(), atlasMesh.vertexCount};
+            vertexData[va.first] = {va.second.dataType(), va.second.componentCount(), atlasMesh.vertexCount};
+        }
+
+        // The buffers are looked up once, instead of per vertex
+        struct Copy {
+            const uint8_t* src;
+            uint8_t* dst;
+            size_t stride;
+        };
+        std::vector<Copy> copies;
+        for (auto& va : vertexData) {
+            copies.push_back({std::as_const(*modelMesh).vertexAttribute(va.first).buffer().data(), va.second[0].begin(), va.second.stride()});
         }
 
         std::vector<glm::vec2> uvs;
         uvs.reserve(atlasMesh.vertexCount);
         for (size_t vert = 0; vert < atlasMesh.vertexCount; vert++) {
             const auto& ivert = atlasMesh.vertexArray[vert];
-            for (auto& va : vertexData) {
-                auto src = modelMesh->vertexAttribute(va.first)[ivert.xref];
-                memcpy(va.second[vert].begin(), src.begin(), va.second.stride());
+            for (const auto& copy : copies) {
+                memcpy(copy.dst + vert * copy.stride, copy.src + ivert.xref * copy.stride, copy.stride);
             }
             uvs.emplace_back(ivert.uv[0] * uscale, ivert.uv[1] * vscale);
         }
@@ -0,0 +1,127 @@
+#include <quad.hpp>
+#include <test.hpp>
+
+#include <checkpoint.hpp>
+#include <raytrace.hpp>
+
+#include <meshtools/ao/bake_scene.hpp>
+#include <meshtools/ao/coverage.hpp>
+#include <meshtools/models/mesh.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+using namespace meshtools;
+using namespace meshtools::ao;
+using namespace meshtools::models;
+
+namespace {
+
+// A unit square facing up that fills the atlas, under a tilted one that occludes part of it. Only the floor is atlased
+std::vector<std::shared_ptr<Mesh>> scene() {
+    return {test::quad(), test::quad({.z = 0.3f, .tilt = 0.4f, .uvMax = 0})};
+}
+
+RaytraceOptions raytraceOptions() {
+    RaytraceOptions options{};
+    options.nsamples = 16;
+    options.resultChannels = 1;
+    options.far = 5;
+    options.multiply = 1;
+    options.threads = 2;
+    options.streamSize = 64;
+    options.minSamples = 16;
+    options.batchSamples = 16;
+    options.tolerance = 0.02f;
+    options.checkpointInterval = 60;
+    return options;
+}
+
+} // namespace
+
+TEST(Checkpoint, Resume) {
+    auto bakeScene = BakeScene::Create(scene());
+    ASSERT_TRUE(bakeScene) << bakeScene.error;
+    const Size<uint32_t> size{128, 128};
+    auto coverage = Coverage::Create(*bakeScene.value, size);
+    ASSERT_TRUE(coverage) << coverage.error;
+    const auto& texels = coverage.value->texels();
+    const auto chunkCount = (texels.size() + TEXEL_CHUNK_SIZE - 1) / TEXEL_CHUNK_SIZE;
+    ASSERT_GT(chunkCount, 2);
+
+    auto options = raytraceOptions();
+    auto reference = raytrace(*bakeScene.value, *coverage.value, options);
+    ASSERT_TRUE(reference) << reference.error;
+
+    // A checkpoint with every other chunk done, with values that no bake produces
+    std::vector<uint8_t> done(chunkCount, 0);
+    Image partial(size.width, size.height, 1);
+    for (size_t chunk = 0; chunk < chunkCount; chunk += 2) {
+        done[chunk] = 1;
+        for (auto i = chunk * TEXEL_CHUNK_SIZE; i < std::min(texels.size(), (chunk + 1) * TEXEL_CHUNK_SIZE); i++) {
+            const auto offset = texels[i].y * size.width + texels[i].x;
+            partial.data()[offset] = 255 - reference.value->data()[offset];
+        }
+    }
+
+    options.checkpoint = std::filesystem::temp_directory_path() / "meshtools-checkpoint-resume.bin";
+    options.resume = true;
+    options.region = coverage.value->region();
+    saveCheckpoint(options.checkpoint, checkpointHash(*bakeScene.value, size, options), done, partial);
+    ASSERT_TRUE(std::filesystem::exists(options.checkpoint));
+
+    // Loads what was saved
+    Image loaded(size.width, size.height, 1);
+    auto loadedChunks = loadCheckpoint(options.checkpoint, checkpointHash(*bakeScene.value, size, options), chunkCount, loaded);
+    ASSERT_TRUE(loadedChunks);
+    ASSERT_EQ(*loadedChunks, done);
+    ASSERT_EQ(loaded.data(), partial.data());
+
+    // The finished chunks are taken from the checkpoint, the others are baked
+    auto resumed = raytrace(*bakeScene.value, *coverage.value, options);
+    ASSERT_TRUE(resumed) << resumed.error;
+    for (size_t i = 0; i < texels.size(); i++) {
+        const auto offset = texels[i].y * size.width + texels[i].x;
+        const auto& expected = done[i / TEXEL_CHUNK_SIZE] ? partial : *reference.value;
+        ASSERT_EQ(resumed.value->data()[offset], expected.data()[offset]) << "texel " << i;
+    }
+
+    // Removed once the bake is done
+    ASSERT_FALSE(std::filesystem::exists(options.checkpoint));
+}
+
+TEST(Checkpoint, IgnoresOtherBakes) {
+    auto bakeScene = BakeScene::Create(scene());
+    ASSERT_TRUE(bakeScene) << bakeScene.error;
+    const Size<uint32_t> size{128, 128};
+    auto coverage = Coverage::Create(*bakeScene.value, size);
+    ASSERT_TRUE(coverage) << coverage.error;
+    const auto chunkCount = (coverage.value->texels().size() + TEXEL_CHUNK_SIZE - 1) / TEXEL_CHUNK_SIZE;
+
+    auto options = raytraceOptions();
+    options.region = coverage.value->region();
+    auto path = std::filesystem::temp_directory_path() / "meshtools-checkpoint-other.bin";
+    Image image(size.width, size.height, 1);
+    saveCheckpoint(path, checkpointHash(*bakeScene.value, size, options), std::vector<uint8_t>(chunkCount, 1), image);
+
+    options.nsamples = 32;
+    ASSERT_FALSE(loadCheckpoint(path, checkpointHash(*bakeScene.value, size, options), chunkCount, image));
+
+    std::filesystem::remove(path);
+}
+
+TEST(Checkpoint, SaveFailure) {
+    // A checkpoint can't replace a directory; the bake carries on without it
+    auto path = std::filesystem::temp_directory_path() / "meshtools-checkpoint-dir";
+    std::filesystem::create_directories(path / "content");
+    auto temporary = path;
+    temporary += ".tmp";
+
+    Image image(4, 4, 1);
+    ASSERT_NO_THROW(saveCheckpoint(path, 1, {1}, image));
+    ASSERT_FALSE(std::filesystem::exists(temporary));
+    ASSERT_TRUE(std::filesystem::is_directory(path));
+
+    std::filesystem::remove_all(path);
+}
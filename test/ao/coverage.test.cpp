@@ -0,0 +1,143 @@
+#include <quad.hpp>
+#include <test.hpp>
+
+#include <meshtools/ao/bake_scene.hpp>
+#include <meshtools/ao/coverage.hpp>
+#include <meshtools/models/mesh.hpp>
+#include <meshtools/models/model.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+using namespace meshtools;
+using namespace meshtools::ao;
+using namespace meshtools::models;
+
+namespace {
+
+std::vector<char> readFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+void writeFile(const std::filesystem::path& path, const std::vector<char>& data) {
+    std::ofstream file(path, std::ios::binary);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+} // namespace
+
+TEST(Coverage, SaveLoad) {
+    auto scene = BakeScene::Create({test::quad()});
+    ASSERT_TRUE(scene) << scene.error;
+    auto coverage = Coverage::Create(*scene.value, {32, 32}, {0, 8, 32, 16}, 1, true);
+    ASSERT_TRUE(coverage) << coverage.error;
+    ASSERT_EQ(coverage.value->texels().size(), 32 * 16);
+
+    auto path = std::filesystem::temp_directory_path() / "meshtools-coverage.bin";
+    coverage.value->save(path, *scene.value);
+    auto loaded = Coverage::Load(path, *scene.value);
+    ASSERT_TRUE(loaded) << loaded.error;
+    ASSERT_EQ(loaded.value->mapSize().width, 32);
+    ASSERT_EQ(loaded.value->mapSize().height, 32);
+    ASSERT_EQ(loaded.value->region().y, 8);
+    ASSERT_EQ(loaded.value->region().height, 16);
+    ASSERT_TRUE(loaded.value->conservative());
+    ASSERT_EQ(loaded.value->texels().size(), coverage.value->texels().size());
+    for (size_t i = 0; i < loaded.value->texels().size(); i++) {
+        ASSERT_EQ(loaded.value->texels()[i].x, coverage.value->texels()[i].x);
+        ASSERT_EQ(loaded.value->texels()[i].y, coverage.value->texels()[i].y);
+        ASSERT_EQ(loaded.value->texels()[i].position, coverage.value->texels()[i].position);
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST(Coverage, LoadRejectsOtherScenes) {
+    auto scene = BakeScene::Create({test::quad()});
+    ASSERT_TRUE(scene) << scene.error;
+    auto coverage = Coverage::Create(*scene.value, {32, 32});
+    ASSERT_TRUE(coverage) << coverage.error;
+
+    auto path = std::filesystem::temp_directory_path() / "meshtools-coverage-other.bin";
+    coverage.value->save(path, *scene.value);
+    auto otherScene = BakeScene::Create({test::quad({.z = 1})});
+    ASSERT_TRUE(otherScene) << otherScene.error;
+    ASSERT_FALSE(Coverage::Load(path, *otherScene.value));
+
+    std::filesystem::remove(path);
+}
+
+TEST(Coverage, LoadRejectsDamagedFiles) {
+    auto scene = BakeScene::Create({test::quad()});
+    ASSERT_TRUE(scene) << scene.error;
+    auto coverage = Coverage::Create(*scene.value, {32, 32});
+    ASSERT_TRUE(coverage) << coverage.error;
+
+    auto path = std::filesystem::temp_directory_path() / "meshtools-coverage-damaged.bin";
+    coverage.value->save(path, *scene.value);
+    const auto data = readFile(path);
+    const auto headerSize = data.size() - coverage.value->texels().size() * sizeof(CoverageTexel);
+
+    // Truncated
+    writeFile(path, std::vector<char>(data.begin(), data.end() - 1));
+    ASSERT_FALSE(Coverage::Load(path, *scene.value));
+
+    // More texels than the header says
+    auto longer = data;
+    longer.insert(longer.end(), data.end() - sizeof(CoverageTexel), data.end());
+    writeFile(path, longer);
+    ASSERT_FALSE(Coverage::Load(path, *scene.value));
+
+    // A texel outside of the region
+    auto outside = data;
+    const uint32_t x = 1000;
+    std::memcpy(outside.data() + headerSize, &x, sizeof(x));
+    writeFile(path, outside);
+    ASSERT_FALSE(Coverage::Load(path, *scene.value));
+
+    // Not a coverage file at all
+    writeFile(path, std::vector<char>(data.size(), 'x'));
+    ASSERT_FALSE(Coverage::Load(path, *scene.value));
+
+    std::filesystem::remove(path);
+}
+
+TEST(Coverage, LoadRejectsMovedInstances) {
+    // The quad, and an occluder that is instanced twice; only its first instance is a baked mesh
+    auto createScene = [](float offset) {
+        std::vector<MeshGroup> meshGroups;
+        meshGroups.emplace_back("floor", test::quad());
+        meshGroups.emplace_back("occluder", test::quad({.z = 0.5f}));
+        std::vector<Node> nodes;
+        nodes.emplace_back(0);
+        nodes.emplace_back(1);
+        nodes.emplace_back(1, Extra{}, glm::translate(glm::mat4{1}, glm::vec3{offset, 0, 0}));
+        const Model model{std::move(meshGroups), std::move(nodes)};
+        return BakeScene::Create(model);
+    };
+
+    auto scene = createScene(2);
+    ASSERT_TRUE(scene) << scene.error;
+    auto coverage = Coverage::Create(*scene.value, {32, 32});
+    ASSERT_TRUE(coverage) << coverage.error;
+
+    auto path = std::filesystem::temp_directory_path() / "meshtools-coverage-instances.bin";
+    coverage.value->save(path, *scene.value);
+    auto sameScene = createScene(2);
+    ASSERT_TRUE(sameScene) << sameScene.error;
+    ASSERT_TRUE(Coverage::Load(path, *sameScene.value));
+
+    // The baked meshes and their transforms are the same, only the second occluder moved
+    auto movedScene = createScene(3);
+    ASSERT_TRUE(movedScene) << movedScene.error;
+    ASSERT_EQ(movedScene.value->meshes().size(), scene.value->meshes().size());
+    ASSERT_EQ(movedScene.value->transforms(), scene.value->transforms());
+    ASSERT_FALSE(Coverage::Load(path, *movedScene.value));
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <meshtools/models/mesh.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace meshtools::test {
+
+struct QuadOptions {
+    // A square of size x size, with a corner at the origin, or centered on it
+    float size = 1;
+    bool centered = false;
+    // Height of the square, and how much higher its far edge along x is
+    float z = 0;
+    float tilt = 0;
+    // Texture coordinates from uvMin to uvMax in both directions. Leave the range empty for an occluder that isn't atlased
+    float uvMin = 0;
+    float uvMax = 1;
+};
+
+// A square facing up, with normals and texture coordinates
+inline std::shared_ptr<models::Mesh> quad(const QuadOptions& options = {}) {
+    using namespace models;
+    const float lo = options.centered ? -options.size / 2 : 0;
+    const float hi = lo + options.size;
+    const float z0 = options.z;
+    const float z1 = options.z + options.tilt;
+    const float uv0 = options.uvMin;
+    const float uv1 = options.uvMax;
+
+    VertexData vertexData;
+    vertexData[AttributeType::POSITION] = TypedData::From(3, std::vector<float>{lo, lo, z0, hi, lo, z1, hi, hi, z1, lo, hi, z0});
+    vertexData[AttributeType::NORMAL] = TypedData::From(3, std::vector<float>{0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1});
+    vertexData[AttributeType::TEXCOORD] = TypedData::From(2, std::vector<float>{uv0, uv0, uv1, uv0, uv1, uv1, uv0, uv1});
+    return std::make_shared<Mesh>("quad", -1, TypedData::From(1, std::vector<uint32_t>{0, 1, 2, 0, 2, 3}), std::move(vertexData));
+}
+
+} // namespace meshtools::test
@@ -0,0 +1,156 @@
+#include <quad.hpp>
+#include <test.hpp>
+
+#include <tiled.hpp>
+
+#include <meshtools/ao/ao.hpp>
+#include <meshtools/ao/bake_scene.hpp>
+#include <meshtools/ao/coverage.hpp>
+#include <meshtools/ao/shard.hpp>
+#include <meshtools/models/mesh.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+using namespace meshtools;
+using namespace meshtools::ao;
+using namespace meshtools::models;
+
+namespace {
+
+// A floor that takes up the middle of the atlas, so there is a gutter around it, under a tilted occluder that
+// isn't atlased
+std::vector<std::shared_ptr<Mesh>> scene() {
+    return {test::quad({.uvMin = 0.1f, .uvMax = 0.9f}), test::quad({.z = 0.3f, .tilt = 0.4f, .uvMax = 0})};
+}
+
+const BakeOptions bakeOptions{
+        .nsamples = 16,
+        .threads = 2,
+        .gutter = 3,
+        .sampler = ao::Sampler::HALTON,
+};
+
+const FilterOptions filterOptions{
+        .denoise = 2,
+        .blurKernelSize = 3,
+        .gutter = bakeOptions.gutter,
+        .threads = 2,
+};
+
+// A single bake of the whole map, filtered after the bake
+std::shared_ptr<Image> singleBake(const BakeScene& bakeScene, const Coverage& coverage) {
+    auto options = bakeOptions;
+    options.gutter = 0;
+    auto result = bake(bakeScene, coverage, options);
+    EXPECT_TRUE(result) << result.error;
+    if (result) {
+        filter(*result.value, coverage, filterOptions);
+    }
+    return result.value;
+}
+
+} // namespace
+
+TEST(Shard, MergeMatchesSingleBake) {
+    auto bakeScene = BakeScene::Create(scene());
+    ASSERT_TRUE(bakeScene) << bakeScene.error;
+    const Size<uint32_t> size{128, 128};
+    auto coverage = Coverage::Create(*bakeScene.value, size);
+    ASSERT_TRUE(coverage) << coverage.error;
+    auto expected = singleBake(*bakeScene.value, *coverage.value);
+    ASSERT_TRUE(expected);
+
+    const ShardJob job{
+            .model = "unused.glb",
+            .mapSize = size,
+            .shards = 2,
+            .options = bakeOptions,
+    };
+    ASSERT_FALSE(job.region(0).empty());
+    ASSERT_FALSE(job.region(1).empty());
+
+    auto jobFile = std::filesystem::temp_directory_path() / "meshtools-shard.job";
+    for (uint32_t shard = 0; shard < job.shards; shard++) {
+        auto shardResult = bakeShard(*bakeScene.value, job, shard, jobFile, 1);
+        ASSERT_TRUE(shardResult) << shardResult.error;
+    }
+
+    auto merged = mergeShards(*bakeScene.value, job, jobFile);
+    ASSERT_TRUE(merged) << merged.error;
+    filter(*merged.value, *coverage.value, filterOptions);
+    ASSERT_EQ(merged.value->data(), expected->data());
+
+    for (uint32_t shard = 0; shard < job.shards; shard++) {
+        std::filesystem::remove(shardFile(jobFile, shard));
+    }
+}
+
+TEST(Shard, TiledMatchesSingleBake) {
+    auto bakeScene = BakeScene::Create(scene());
+    ASSERT_TRUE(bakeScene) << bakeScene.error;
+    const Size<uint32_t> size{128, 128};
+    auto coverage = Coverage::Create(*bakeScene.value, size);
+    ASSERT_TRUE(coverage) << coverage.error;
+    auto expected = singleBake(*bakeScene.value, *coverage.value);
+    ASSERT_TRUE(expected);
+
+    // Room for bands of a few rows, plus the rows the filters reach on both sides
+    auto path = std::filesystem::temp_directory_path() / "meshtools-tiled.png";
+    const TiledBakeOptions tiledOptions{
+            .memoryBudget = size.width * bandTexelBytes(bakeOptions.channels, filterOptions) * (2 * filterOptions.reach() + 24),
+            .denoise = filterOptions.denoise,
+            .blurKernelSize = filterOptions.blurKernelSize,
+    };
+    auto tiledResult = bakeTiled(*bakeScene.value, size, path, bakeOptions, tiledOptions);
+    ASSERT_TRUE(tiledResult) << tiledResult.error;
+
+    std::ifstream file(path, std::ios::binary);
+    auto encoded = Image::Encoded({std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()});
+    ASSERT_TRUE(encoded) << encoded.error;
+    auto decoded = encoded->decode();
+    ASSERT_TRUE(decoded) << decoded.error;
+    ASSERT_EQ(decoded->data(), expected->data());
+
+    file.close();
+    std::filesystem::remove(path);
+}
+
+TEST(Shard, RejectsOtherJobs) {
+    auto bakeScene = BakeScene::Create(scene());
+    ASSERT_TRUE(bakeScene) << bakeScene.error;
+    const ShardJob job{
+            .model = "unused.glb",
+            .mapSize = {64, 128},
+            .shards = 2,
+            .options = bakeOptions,
+    };
+
+    auto jobFile = std::filesystem::temp_directory_path() / "meshtools-shard-other.job";
+    for (uint32_t shard = 0; shard < job.shards; shard++) {
+        auto shardResult = bakeShard(*bakeScene.value, job, shard, jobFile, 1);
+        ASSERT_TRUE(shardResult) << shardResult.error;
+    }
+    ASSERT_TRUE(mergeShards(*bakeScene.value, job, jobFile));
+
+    // The same regions, but other options
+    auto otherOptions = job;
+    otherOptions.options.nsamples = 32;
+    auto merged = mergeShards(*bakeScene.value, otherOptions, jobFile);
+    ASSERT_FALSE(merged);
+    ASSERT_NE(merged.error.find("another"), std::string::npos) << merged.error;
+
+    // Another model
+    auto meshes = scene();
+    meshes.pop_back();
+    auto otherScene = BakeScene::Create(meshes);
+    ASSERT_TRUE(otherScene) << otherScene.error;
+    ASSERT_FALSE(mergeShards(*otherScene.value, job, jobFile));
+
+    for (uint32_t shard = 0; shard < job.shards; shard++) {
+        std::filesystem::remove(shardFile(jobFile, shard));
+    }
+}
@@ -0,0 +1,47 @@
+#include <test.hpp>
+
+#include <tiled.hpp>
+
+#include <meshtools/ao/coverage.hpp>
+
+using namespace meshtools;
+using namespace meshtools::ao;
+
+TEST(Tiled, TexelBytes) {
+    // The coverage texel dominates, it is held twice while the coverage is created
+    const FilterOptions blur{.blurKernelSize = 5};
+    ASSERT_EQ(bandTexelBytes(1, blur), 2 * sizeof(CoverageTexel));
+
+    // Guides and value planes of the denoise on top of the coverage and the image
+    const FilterOptions denoise{.denoise = 2, .blurKernelSize = 5, .gutter = 4};
+    const size_t guides = 2 * sizeof(glm::vec3) + sizeof(uint32_t) + 2 * 3 * sizeof(float);
+    ASSERT_EQ(bandTexelBytes(4, denoise), sizeof(CoverageTexel) + std::max(sizeof(CoverageTexel), 4 + guides));
+
+    // Far more than the output rows
+    ASSERT_GT(bandTexelBytes(1, {}), 10u);
+}
+
+TEST(Tiled, BandHeight) {
+    const FilterOptions options{.blurKernelSize = 5};
+    const uint32_t width = 1000;
+    const size_t rowBytes = width * bandTexelBytes(1, options);
+    const size_t halo = options.reach();
+    ASSERT_EQ(halo, 5);
+
+    // Bands and their halos fit into the budget
+    ASSERT_EQ(bandHeight(rowBytes * (64 + 2 * halo), width, 4096, 1, options), 64);
+    ASSERT_EQ(bandHeight(rowBytes * (64 + 2 * halo) - 1, width, 4096, 1, options), 63);
+    // Aligned to 64 rows when there is room for more
+    ASSERT_EQ(bandHeight(rowBytes * (200 + 2 * halo), width, 4096, 1, options), 192);
+    // No more than the region
+    ASSERT_EQ(bandHeight(rowBytes * (200 + 2 * halo), width, 30, 1, options), 30);
+    // Not even a single row
+    ASSERT_EQ(bandHeight(rowBytes * (1 + 2 * halo) - 1, width, 4096, 1, options), 0);
+    ASSERT_EQ(bandHeight(rowBytes * (1 + 2 * halo), width, 4096, 1, options), 1);
+
+    // The budget that only counted the output rows gave bands of a hundred times as many rows
+    const size_t budget = size_t{64} * 1024 * 1024;
+    const auto rows = bandHeight(budget, width, 1u << 20, 1, options);
+    ASSERT_GT(rows, 0);
+    ASSERT_LE((rows + 2 * halo) * rowBytes, budget);
+}
@@ -0,0 +1,58 @@
+#include <quad.hpp>
+#include <test.hpp>
+
+#include <meshtools/ao/ao.hpp>
+#include <meshtools/models/mesh.hpp>
+
+#include <memory>
+#include <vector>
+
+using namespace meshtools;
+using namespace meshtools::models;
+
+namespace {
+
+std::vector<float> vertexAO(const Mesh& mesh) {
+    std::vector<float> result;
+    for (const auto& color : mesh.vertexAttribute<glm::vec4>(AttributeType::COLOR)) {
+        result.push_back(color[0]);
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(VertexBake, Unoccluded) {
+    for (bool averageTriangles : {false, true}) {
+        auto floor = test::quad({.centered = true});
+        auto result = ao::bakeVertices({floor}, {.nsamples = 64, .averageTriangles = averageTriangles});
+        ASSERT_TRUE(result) << result.error;
+        ASSERT_EQ(result.value->texels, averageTriangles ? 6 : 4);
+
+        auto values = vertexAO(*floor);
+        ASSERT_EQ(values.size(), 4);
+        for (auto value : values) {
+            EXPECT_FLOAT_EQ(value, 1.0f);
+        }
+    }
+}
+
+TEST(VertexBake, CloseOccluder) {
+    // The ceiling is closer than the near distance of texel rays, vertex rays start at the vertex offset
+    for (bool averageTriangles : {false, true}) {
+        auto floor = test::quad({.centered = true});
+        auto ceiling = test::quad({.size = 10, .centered = true, .z = 0.2f});
+        auto result = ao::bakeVertices({floor, ceiling}, {.nsamples = 64, .vertexOffset = 0.01f, .averageTriangles = averageTriangles});
+        ASSERT_TRUE(result) << result.error;
+
+        for (auto value : vertexAO(*floor)) {
+            EXPECT_LT(value, 0.2f);
+        }
+    }
+}
+
+TEST(VertexBake, NoSamples) {
+    auto floor = test::quad({.centered = true});
+    auto result = ao::bakeVertices({floor}, {.nsamples = 0});
+    ASSERT_FALSE(result);
+}
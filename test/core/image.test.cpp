@@ -0,0 +1,314 @@
+#include <test.hpp>
+
+#include <meshtools/image.hpp>
+
+#include <cmath>
+#include <limits>
+#include <string>
+
+using namespace meshtools;
+
+TEST(Image, Dilate) {
+    const uint32_t size = 32;
+    Image image(size, size, 2);
+    Image mask(size, size, 1);
+    // Two charts, the left one dark and the right one bright
+    for (uint32_t y = 8; y < 24; y++) {
+        for (uint32_t x = 4; x < 12; x++) {
+            mask.data()[y * size + x] = 255;
+            image.data()[(y * size + x) * 2] = 50;
+            image.data()[(y * size + x) * 2 + 1] = 60;
+        }
+        for (uint32_t x = 20; x < 28; x++) {
+            mask.data()[y * size + x] = 255;
+            image.data()[(y * size + x) * 2] = 200;
+            image.data()[(y * size + x) * 2 + 1] = 210;
+        }
+    }
+    auto original = image.data();
+
+    image.dilate(mask, 3, 4);
+
+    auto at = [&](uint32_t x, uint32_t y) { return image.data()[(y * size + x) * 2]; };
+    // Inside is untouched
+    for (size_t i = 0; i < mask.data().size(); i++) {
+        if (mask.data()[i]) {
+            ASSERT_EQ(image.data()[i * 2], original[i * 2]);
+        }
+    }
+    // The gutter takes the nearest chart, with all channels
+    ASSERT_EQ(at(12, 10), 50);
+    ASSERT_EQ(image.data()[(10 * size + 12) * 2 + 1], 60);
+    ASSERT_EQ(at(14, 10), 50);
+    ASSERT_EQ(at(18, 10), 200);
+    ASSERT_EQ(at(1, 8), 50);
+    ASSERT_EQ(at(8, 5), 50);
+    // Corners are within the euclidean distance
+    ASSERT_EQ(at(13, 25), 50);
+    // Beyond the gutter stays empty
+    ASSERT_EQ(at(0, 10), 0);
+    ASSERT_EQ(at(16, 10), 0);
+    ASSERT_EQ(at(8, 4), 0);
+    ASSERT_EQ(at(14, 26), 0);
+}
+
+TEST(Image, DilateMatchesBruteForce) {
+    const uint32_t width = 61;
+    const uint32_t height = 47;
+    Image image(width, height, 1);
+    Image mask(width, height, 1);
+    for (uint32_t i = 0; i < width * height; i++) {
+        // Sparse seeds with distinct values
+        if ((i * 2654435761u) % 97 == 0) {
+            mask.data()[i] = 255;
+            image.data()[i] = 1 + i % 250;
+        }
+    }
+
+    const uint32_t gutter = 6;
+    image.dilate(mask, gutter);
+
+    size_t filled = 0;
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            int64_t best = std::numeric_limits<int64_t>::max();
+            for (uint32_t i = 0; i < width * height; i++) {
+                if (mask.data()[i]) {
+                    int64_t dx = int64_t(i % width) - x;
+                    int64_t dy = int64_t(i / width) - y;
+                    best = std::min(best, dx * dx + dy * dy);
+                }
+            }
+            auto value = image.data()[y * width + x];
+            if (best > gutter * gutter) {
+                ASSERT_EQ(value, 0);
+                continue;
+            }
+            // Every texel within the gutter of a seed is reached
+            ASSERT_NE(value, 0);
+            filled++;
+        }
+    }
+    ASSERT_GT(filled, width * height / 2);
+}
+
+TEST(Image, BlurMatchesReference) {
+    const uint32_t width = 37;
+    const uint32_t height = 23;
+    const int radius = 3;
+    Image image(width, height, 1);
+    for (uint32_t i = 0; i < width * height; i++) {
+        // Some empty texels, which don't contribute
+        image.data()[i] = (i % 11 == 0) ? 0 : 40 + (i * 37) % 200;
+    }
+    auto original = image.data();
+
+    image.blur(radius, 3);
+
+    for (int y = 0; y < (int) height; y++) {
+        for (int x = 0; x < (int) width; x++) {
+            double sum = 0.0;
+            double color = 0.0;
+            for (int sy = std::max(0, y - radius); sy <= std::min((int) height - 1, y + radius); sy++) {
+                for (int sx = std::max(0, x - radius); sx <= std::min((int) width - 1, x + radius); sx++) {
+                    auto value = original[sy * width + sx];
+                    if (value == 0) {
+                        continue;
+                    }
+                    auto weight = std::exp(-((sx - x) * (sx - x) + (sy - y) * (sy - y)) / 32.0);
+                    color += weight * value;
+                    sum += weight;
+                }
+            }
+            ASSERT_NEAR(image.data()[y * width + x], color / sum, 1.0) << x << ", " << y;
+        }
+    }
+}
+
+TEST(Image, BlurWithMask) {
+    const uint32_t size = 16;
+    Image image(size, size, 4);
+    Image mask(size, size, 1);
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            auto* pixel = &image.data()[(y * size + x) * 4];
+            const bool inside = x >= 4 && x < 12 && y >= 4 && y < 12;
+            mask.data()[y * size + x] = inside ? 255 : 0;
+            std::fill_n(pixel, 3, inside ? 100 : 7);
+            pixel[3] = 255;
+        }
+    }
+
+    auto unmasked = image;
+    unmasked.blur(5);
+    ASSERT_LT(unmasked.data()[(4 * size + 4) * 4], 100);
+
+    image.blur(mask, 5);
+
+    // The background neither contributes to nor is changed by the blur
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            const auto* pixel = &image.data()[(y * size + x) * 4];
+            auto expected = mask.data()[y * size + x] ? 100 : 7;
+            ASSERT_EQ(pixel[0], expected);
+            ASSERT_EQ(pixel[2], expected);
+            ASSERT_EQ(pixel[3], 255);
+        }
+    }
+}
+
+TEST(Image, DenoiseKeepsChartsApart) {
+    const uint32_t width = 32;
+    const uint32_t height = 16;
+    Image image(width, height, 1);
+    DenoiseGuides guides{
+            .positions = std::vector<glm::vec3>(width * height),
+            .normals = std::vector<glm::vec3>(width * height, glm::vec3{0.0f, 0.0f, 1.0f}),
+            .charts = std::vector<uint32_t>(width * height),
+    };
+
+    // Two flat, adjacent charts with noisy values around 64 and 192
+    uint32_t noise = 1;
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            const auto i = y * width + x;
+            noise = noise * 1664525u + 1013904223u;
+            const int offset = static_cast<int>(noise >> 27) - 16;
+            image.data()[i] = (x < width / 2 ? 64 : 192) + offset;
+            guides.positions[i] = {static_cast<float>(x), static_cast<float>(y), 0.0f};
+            guides.charts[i] = x < width / 2 ? 1 : 2;
+        }
+    }
+    guides.charts[0] = 0;
+    image.data()[0] = 0;
+
+    auto deviation = [&](uint32_t chart, float mean) {
+        double sum = 0.0;
+        size_t count = 0;
+        for (uint32_t i = 0; i < width * height; i++) {
+            if (guides.charts[i] == chart) {
+                sum += (image.data()[i] - mean) * (image.data()[i] - mean);
+                count++;
+            }
+        }
+        return std::sqrt(sum / count);
+    };
+    const auto before = deviation(1, 64.0f);
+
+    image.denoise(guides, {.valueSigma = 1.0f, .threads = 2});
+
+    ASSERT_LT(deviation(1, 64.0f), before / 3);
+    ASSERT_LT(deviation(2, 192.0f), before / 3);
+    // Empty texels are left alone
+    ASSERT_EQ(image.data()[0], 0);
+}
+
+TEST(Image, Png) {
+    const uint32_t width = 300;
+    const uint32_t height = 2000;
+    Image image(width, height, 3);
+    for (size_t i = 0; i < image.data().size(); i++) {
+        image.data()[i] = static_cast<uint8_t>(i / 5);
+    }
+
+    // Compressed in several bands, which must still form one valid stream
+    auto png = image.png(4);
+    ASSERT_EQ(png.type(), Image::Type::PNG);
+    const auto& data = png.data();
+    const std::vector<uint8_t> signature{0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    ASSERT_TRUE(std::equal(signature.begin(), signature.end(), data.begin()));
+    ASSERT_EQ(std::string(data.begin() + 12, data.begin() + 16), "IHDR");
+    ASSERT_EQ(std::string(data.begin() + 37, data.begin() + 41), "IDAT");
+    ASSERT_EQ(data[41], 0x78);
+    ASSERT_EQ(std::string(data.end() - 8, data.end() - 4), "IEND");
+    ASSERT_LT(data.size(), image.data().size() / 4);
+
+    // The bands decode to the same pixels as a single threaded encode
+    auto single = image.png(1);
+    for (const auto* encodedPng : {&png, &single}) {
+        auto encoded = Image::Encoded(encodedPng->data());
+        ASSERT_TRUE(encoded) << encoded.error;
+        auto decoded = encoded->decode();
+        ASSERT_TRUE(decoded) << decoded.error;
+        ASSERT_EQ(decoded->width(), width);
+        ASSERT_EQ(decoded->height(), height);
+        ASSERT_EQ(decoded->channels(), 3);
+        ASSERT_EQ(decoded->data(), image.data());
+    }
+}
+
+TEST(Image, Encoded) {
+    Image image(40, 30, 4);
+    for (size_t i = 0; i < image.data().size(); i++) {
+        image.data()[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    // Kept as it is until it's decoded
+    auto encoded = Image::Encoded(image.png().data());
+    ASSERT_TRUE(encoded);
+    ASSERT_EQ(encoded->type(), Image::Type::PNG);
+    ASSERT_EQ(encoded->mimeType(), "image/png");
+    ASSERT_EQ(encoded->width(), 40);
+    ASSERT_EQ(encoded->height(), 30);
+    ASSERT_EQ(encoded->channels(), 4);
+    ASSERT_EQ(encoded->data(), image.png().data());
+
+    auto decoded = encoded->decode();
+    ASSERT_TRUE(decoded);
+    ASSERT_EQ(decoded->type(), Image::Type::RAW);
+    ASSERT_EQ(decoded->data(), image.data());
+
+    ASSERT_FALSE(Image::Encoded(std::vector<uint8_t>(100, 0)));
+}
+
+TEST(Image, Ktx2) {
+    const uint32_t width = 37;
+    const uint32_t height = 21;
+    Image image(width, height, 1);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            image.data()[y * width + x] = static_cast<uint8_t>(40 + 4 * x + 3 * y);
+        }
+    }
+
+    auto ktx2 = image.ktx2(4);
+    ASSERT_EQ(ktx2.type(), Image::Type::KTX2);
+    const auto& data = ktx2.data();
+    auto uint32 = [&](size_t offset) {
+        return data[offset] | (data[offset + 1] << 8) | (data[offset + 2] << 16) | (static_cast<uint32_t>(data[offset + 3]) << 24);
+    };
+    const std::vector<uint8_t> identifier{0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n'};
+    ASSERT_TRUE(std::equal(identifier.begin(), identifier.end(), data.begin()));
+    ASSERT_EQ(uint32(12), 139); // BC4
+    ASSERT_EQ(uint32(20), width);
+    ASSERT_EQ(uint32(24), height);
+    // 37x21 down to 1x1
+    ASSERT_EQ(uint32(40), 6);
+
+    // Decode the first level
+    const size_t offset = uint32(80);
+    const size_t blocksX = (width + 3) / 4;
+    ASSERT_EQ(uint32(88), blocksX * ((height + 3) / 4) * 8);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            const auto* block = &data[offset + ((y / 4) * blocksX + x / 4) * 8];
+            uint64_t bits = 0;
+            for (int i = 0; i < 6; i++) {
+                bits |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+            }
+            const auto index = (bits >> (3 * ((y % 4) * 4 + x % 4))) & 7;
+            const float red0 = block[0];
+            const float red1 = block[1];
+            const float value = index == 0 ? red0 : index == 1 ? red1 : ((8 - index) * red0 + (index - 1) * red1) / 7;
+            ASSERT_NEAR(value, image.data()[y * width + x], 2.0f) << x << ", " << y;
+        }
+    }
+
+    auto encoded = Image::Encoded(data);
+    ASSERT_TRUE(encoded);
+    ASSERT_EQ(encoded->type(), Image::Type::KTX2);
+    ASSERT_EQ(encoded->mimeType(), "image/ktx2");
+    ASSERT_EQ(encoded->width(), width);
+    ASSERT_EQ(encoded->height(), height);
+    ASSERT_EQ(encoded->channels(), 1);
+}
@@ -0,0 +1,66 @@
+#include <test.hpp>
+
+#include <meshtools/parallel.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace meshtools;
+
+TEST(Parallel, VisitsEveryTaskOnce) {
+    const size_t taskCount = 1000;
+    std::vector<std::atomic<int>> visits(taskCount);
+
+    parallel::forEach(taskCount, 8, [&](size_t task, size_t worker) {
+        ASSERT_LT(worker, 8);
+        visits[task]++;
+    });
+
+    for (auto& count : visits) {
+        ASSERT_EQ(count, 1);
+    }
+}
+
+TEST(Parallel, UnevenTasks) {
+    const size_t taskCount = 64;
+    std::vector<std::atomic<int>> visits(taskCount);
+
+    // Front-loaded work forces the other workers to steal
+    parallel::forEach(taskCount, 4, [&](size_t task, size_t) {
+        if (task < 4) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        visits[task]++;
+    });
+
+    for (auto& count : visits) {
+        ASSERT_EQ(count, 1);
+    }
+}
+
+TEST(Parallel, SingleThreadRunsInOrder) {
+    std::vector<size_t> order;
+    parallel::forEach(10, 1, [&](size_t task, size_t worker) {
+        ASSERT_EQ(worker, 0);
+        order.push_back(task);
+    });
+
+    ASSERT_EQ(order.size(), 10);
+    for (size_t i = 0; i < order.size(); i++) {
+        ASSERT_EQ(order[i], i);
+    }
+}
+
+TEST(Parallel, PropagatesExceptions) {
+    ASSERT_THROW(parallel::forEach(100,
+                                   4,
+                                   [](size_t task, size_t) {
+                                       if (task == 42) {
+                                           throw std::runtime_error("failed");
+                                       }
+                                   }),
+                 std::runtime_error);
+}
@@ -0,0 +1,96 @@
+#include <test.hpp>
+
+#include <meshtools/image.hpp>
+#include <meshtools/png_writer.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace meshtools;
+
+namespace {
+
+std::vector<uint8_t> readFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+} // namespace
+
+TEST(PngWriter, WritesRows) {
+    auto path = std::filesystem::temp_directory_path() / "meshtools-png-writer.png";
+    const uint32_t width = 33;
+    const uint32_t height = 17;
+    std::vector<uint8_t> rows(width * height * 3);
+    for (size_t i = 0; i < rows.size(); i++) {
+        rows[i] = static_cast<uint8_t>(i / 7);
+    }
+
+    auto writer = PngWriter::Open(path, width, height, 3);
+    ASSERT_TRUE(writer);
+    writer.value->write(rows.data(), 10);
+    writer.value->write(rows.data() + 10 * width * 3, height - 10);
+    ASSERT_EQ(writer.value->rows(), height);
+    ASSERT_TRUE(writer.value->finish());
+
+    auto data = readFile(path);
+    ASSERT_GT(data.size(), 8 + 25 + 12 + 12);
+    const std::vector<uint8_t> signature{0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    ASSERT_TRUE(std::equal(signature.begin(), signature.end(), data.begin()));
+    // IHDR: width, height, bit depth and color type
+    ASSERT_EQ(std::string(data.begin() + 12, data.begin() + 16), "IHDR");
+    ASSERT_EQ(data[19], width);
+    ASSERT_EQ(data[23], height);
+    ASSERT_EQ(data[24], 8);
+    ASSERT_EQ(data[25], 2);
+    ASSERT_EQ(std::string(data.end() - 8, data.end() - 4), "IEND");
+
+    // Rows from separate writes form one valid stream
+    auto encoded = Image::Encoded(data);
+    ASSERT_TRUE(encoded) << encoded.error;
+    auto decoded = encoded->decode();
+    ASSERT_TRUE(decoded) << decoded.error;
+    ASSERT_EQ(decoded->width(), width);
+    ASSERT_EQ(decoded->height(), height);
+    ASSERT_EQ(decoded->channels(), 3);
+    ASSERT_EQ(decoded->data(), rows);
+
+    std::filesystem::remove(path);
+}
+
+TEST(PngWriter, MatchesImagePng) {
+    auto path = std::filesystem::temp_directory_path() / "meshtools-png-writer-bands.png";
+    const uint32_t width = 250;
+    const uint32_t height = 600;
+    Image image(width, height, 1);
+    for (size_t i = 0; i < image.data().size(); i++) {
+        image.data()[i] = static_cast<uint8_t>((i % width) * (i / width) / 11);
+    }
+
+    // Many rows at once are compressed in parallel bands
+    auto writer = PngWriter::Open(path, width, height, 1);
+    ASSERT_TRUE(writer);
+    writer.value->write(image.data().data(), height, 4);
+    ASSERT_TRUE(writer.value->finish());
+
+    auto encoded = Image::Encoded(readFile(path));
+    ASSERT_TRUE(encoded) << encoded.error;
+    auto decoded = encoded->decode();
+    ASSERT_TRUE(decoded) << decoded.error;
+    ASSERT_EQ(decoded->data(), image.data());
+
+    std::filesystem::remove(path);
+}
+
+TEST(PngWriter, FailsIncomplete) {
+    auto path = std::filesystem::temp_directory_path() / "meshtools-png-writer-incomplete.png";
+    auto writer = PngWriter::Open(path, 4, 4, 1);
+    ASSERT_TRUE(writer);
+    std::vector<uint8_t> row(4);
+    writer.value->write(row.data(), 1);
+    ASSERT_FALSE(writer.value->finish());
+
+    std::filesystem::remove(path);
+}
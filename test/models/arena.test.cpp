@@ -0,0 +1,78 @@
+#include <test.hpp>
+
+#include <meshtools/models/arena.hpp>
+#include <meshtools/models/mesh_data.hpp>
+#include <meshtools/models/model.hpp>
+
+#include <memory>
+
+using namespace meshtools::models;
+
+TEST(Arena, TypedData) {
+    auto arena = std::make_shared<Arena>(1024);
+    ASSERT_EQ(arena->used(), 0);
+
+    TypedData typedData(DataType::FLOAT, 3, 5, arena);
+    ASSERT_EQ(typedData.arena(), arena);
+    ASSERT_EQ(typedData.size(), 5);
+    ASSERT_GE(arena->used(), typedData.buffer().size() + TypedData::TAIL_PADDING);
+    ASSERT_GE(arena->footprint(), arena->used());
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(typedData.buffer().data()) % alignof(std::max_align_t), 0);
+
+    // Copies and conversions stay in the arena
+    auto used = arena->used();
+    auto copy = typedData;
+    copy[0];
+    ASSERT_FALSE(copy.shared());
+    ASSERT_EQ(copy.arena(), arena);
+    ASSERT_GT(arena->used(), used);
+    ASSERT_EQ(typedData.convert(DataType::U_BYTE).arena(), arena);
+
+    // Data without an arena is on the heap
+    used = arena->used();
+    auto heap = TypedData::From(1, std::vector<uint32_t>{0, 1, 2});
+    ASSERT_EQ(heap.arena(), nullptr);
+    ASSERT_EQ(arena->used(), used);
+}
+
+TEST(Arena, OutlivesModel) {
+    auto arena = std::make_shared<Arena>();
+    TypedData typedData = TypedData::From(1, std::vector<uint32_t>{0, 1, 2});
+    {
+        TypedData inArena(DataType::U_INT, 1, 3, arena);
+        inArena.copyFrom(typedData.buffer().data());
+        typedData = inArena;
+    }
+    arena.reset();
+
+    // The data keeps the arena alive
+    ASSERT_NE(typedData.arena(), nullptr);
+    ASSERT_EQ(DataView<uint32_t>{typedData}[2], 2);
+}
+
+TEST(Arena, Grows) {
+    Arena arena(64);
+    for (size_t i = 0; i < 100; i++) {
+        auto* p = arena.allocate(100, 4);
+        ASSERT_NE(p, nullptr);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(p) % 4, 0);
+    }
+    ASSERT_EQ(arena.used(), 100 * 100);
+    ASSERT_GE(arena.footprint(), 100 * 100);
+}
+
+TEST(Arena, TransformedMeshes) {
+    auto arena = std::make_shared<Arena>();
+    auto modelResult = Model::Load(getFixturesPath("models/basic.gltf"), arena);
+    ASSERT_TRUE(modelResult);
+    const auto& model = *modelResult.value;
+
+    // The node is translated, so the flattened positions are new data
+    auto meshes = model.meshes(0, true);
+    ASSERT_EQ(meshes.size(), 1);
+    const auto& original = model.meshGroups()[0].meshes()[0];
+    const auto& positions = meshes[0]->vertexAttribute(AttributeType::POSITION);
+    ASSERT_NE(positions.buffer().data(), original->vertexAttribute(AttributeType::POSITION).buffer().data());
+    ASSERT_EQ(positions.arena(), arena);
+    ASSERT_EQ(meshes[0]->indices().arena(), arena);
+}
@@ -27,3 +27,17 @@ TEST(AttributeType, Custom) {
     ASSERT_TRUE(values.find(AttributeType{"_CUSTOM_0"}) != values.end());
     ASSERT_EQ(values[AttributeType{"_CUSTOM_0"}], 1);
 }
+
+TEST(AttributeType, Interned) {
+    ASSERT_EQ(AttributeType{"POSITION"}, AttributeType::POSITION);
+    ASSERT_EQ(AttributeType{"TEXCOORD_0"}, AttributeType::TEXCOORD);
+    ASSERT_EQ(AttributeType::POSITION.name(), "POSITION");
+    ASSERT_EQ(AttributeType::COLOR.name(), "COLOR_0");
+
+    // Common attributes come first, custom ones keep their id
+    AttributeType custom{"_FEATURE_ID_0"};
+    ASSERT_LT(AttributeType::COLOR, custom);
+    ASSERT_EQ(AttributeType{"_FEATURE_ID_0"}.id(), custom.id());
+    ASSERT_NE(AttributeType{"_FEATURE_ID_1"}, custom);
+    ASSERT_EQ(custom.name(), "_FEATURE_ID_0");
+}
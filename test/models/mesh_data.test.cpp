@@ -2,7 +2,10 @@
 
 #include <meshtools/models/mesh_data.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
+#include <limits>
 
 using namespace meshtools::models;
 
@@ -159,6 +162,148 @@ TEST(MeshData, DataViewIterableComplexTypeConversion) {
     }
 }
 
+TEST(MeshData, DataViewSignedConversion) {
+    std::vector<int16_t> data{-1, 2, std::numeric_limits<int16_t>::min()};
+    TypedData typedData = TypedData::From(1, data);
+    DataView<int32_t> dataView{typedData};
+
+    ASSERT_EQ(dataView.contiguous(), nullptr);
+    for (size_t index = 0; index < data.size(); index++) {
+        ASSERT_EQ(dataView[index], data[index]);
+    }
+}
+
+TEST(MeshData, DataViewMaterialize) {
+    std::vector<uint16_t> data{0, 1, 2, 3, 4, 5};
+    TypedData typedData = TypedData::From(1, data);
+
+    DataView<uint16_t> inPlace{typedData};
+    ASSERT_EQ(inPlace.contiguous(), reinterpret_cast<const uint16_t*>(typedData.buffer().data()));
+
+    DataView<uint32_t> converted{typedData};
+    ASSERT_EQ(converted.contiguous(), nullptr);
+    ASSERT_EQ(converted.materialize(), (std::vector<uint32_t>{0, 1, 2, 3, 4, 5}));
+}
+
+TEST(MeshData, NormalizedView) {
+    std::vector<uint8_t> data{0, 255, 51, 102};
+    TypedData typedData{DataType::U_BYTE, 2, data};
+    NormalizedView<glm::vec2> view{typedData};
+
+    ASSERT_EQ(view.size(), 2);
+    ASSERT_FLOAT_EQ(view[0][0], 0.0f);
+    ASSERT_FLOAT_EQ(view[0][1], 1.0f);
+    ASSERT_FLOAT_EQ(view[1][0], 0.2f);
+    ASSERT_FLOAT_EQ(view[1][1], 0.4f);
+
+    std::vector<int16_t> signedData{std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max()};
+    TypedData signedTypedData = TypedData::From(1, signedData);
+    NormalizedView<float> signedView{signedTypedData};
+    ASSERT_FLOAT_EQ(signedView[0], -1.0f);
+    ASSERT_FLOAT_EQ(signedView[1], 1.0f);
+
+    // Floats are used as they are
+    TypedData floats = TypedData::From(DataType::FLOAT, 2, std::vector<float>{0.5f, 2.0f});
+    NormalizedView<glm::vec2> floatView{floats};
+    ASSERT_NE(floatView.contiguous(), nullptr);
+    ASSERT_FLOAT_EQ(floatView[0][1], 2.0f);
+}
+
+TEST(MeshData, Convert) {
+    // Long enough for the vectorized part and a remainder
+    std::vector<int16_t> data;
+    for (int i = 0; i < 21; i++) {
+        data.push_back(static_cast<int16_t>(i * 3000 - 32768));
+    }
+    auto typedData = TypedData::From(3, data);
+
+    auto widened = typedData.convert(DataType::INT);
+    ASSERT_EQ(widened.dataType(), DataType::INT);
+    ASSERT_EQ(widened.componentCount(), 3);
+    ASSERT_EQ(widened.size(), 7);
+    DataView<glm::i32vec3> widenedView{widened};
+    ASSERT_NE(widenedView.contiguous(), nullptr);
+    for (size_t i = 0; i < data.size(); i++) {
+        ASSERT_EQ(widenedView[i / 3][i % 3], data[i]);
+    }
+
+    auto normalized = typedData.convert(DataType::FLOAT, true);
+    DataView<glm::vec3> normalizedView{normalized};
+    for (size_t i = 0; i < data.size(); i++) {
+        ASSERT_FLOAT_EQ(normalizedView[i / 3][i % 3], std::max(data[i] / 32767.0f, -1.0f));
+    }
+
+    auto narrowed = TypedData::From(1, std::vector<float>{0.0f, 1.5f, 200.0f, 255.0f, 7.9f, 8.0f, 9.0f, 10.0f, 11.0f}).convert(DataType::U_BYTE);
+    ASSERT_EQ(std::vector<uint8_t>(narrowed.buffer().begin(), narrowed.buffer().end()),
+              (std::vector<uint8_t>{0, 1, 200, 255, 7, 8, 9, 10, 11}));
+}
+
+TEST(MeshData, ConvertOutOfRange) {
+    // Clamped to the range of the integer type in the vectorized part and the remainder, NaN becomes 0
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    std::vector<float> data;
+    for (int i = 0; i < 2; i++) {
+        data.insert(data.end(), {-1e10f, 1e10f, -300.0f, 300.0f, nan, 2147483647.0f, -2.5f, 42.9f});
+    }
+    auto typedData = TypedData::From(1, data);
+
+    auto bytes = typedData.convert(DataType::U_BYTE);
+    ASSERT_EQ(std::vector<uint8_t>(bytes.buffer().begin(), bytes.buffer().end()),
+              (std::vector<uint8_t>{0, 255, 0, 255, 0, 255, 0, 42, 0, 255, 0, 255, 0, 255, 0, 42}));
+
+    auto shorts = typedData.convert(DataType::SHORT);
+    std::vector<int16_t> shortValues(data.size());
+    std::memcpy(shortValues.data(), shorts.buffer().data(), shorts.buffer().size());
+    ASSERT_EQ(shortValues, (std::vector<int16_t>{-32768, 32767, -300, 300, 0, 32767, -2, 42, -32768, 32767, -300, 300, 0, 32767, -2, 42}));
+
+    // 2^31 - 1 isn't a float, the largest float below it is the limit
+    auto ints = typedData.convert(DataType::INT);
+    std::vector<int32_t> intValues(data.size());
+    std::memcpy(intValues.data(), ints.buffer().data(), ints.buffer().size());
+    for (size_t i = 0; i < data.size(); i += 8) {
+        ASSERT_EQ(intValues[i], std::numeric_limits<int32_t>::min());
+        ASSERT_EQ(intValues[i + 1], 2147483520);
+        ASSERT_EQ(intValues[i + 4], 0);
+        ASSERT_EQ(intValues[i + 5], 2147483520);
+    }
+
+    auto unsignedInts = TypedData::From(1, std::vector<double>{-1.0, 1e20, 4294967295.0, 0.5, nan, 7.0, 8.0, 9.0, 1e20}).convert(DataType::U_INT);
+    std::vector<uint32_t> unsignedValues(9);
+    std::memcpy(unsignedValues.data(), unsignedInts.buffer().data(), unsignedInts.buffer().size());
+    ASSERT_EQ(unsignedValues, (std::vector<uint32_t>{0, 4294967295u, 4294967295u, 0, 0, 7, 8, 9, 4294967295u}));
+}
+
+TEST(MeshData, ConvertToDouble) {
+    std::vector<int32_t> data{std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max(), 123456789, -1, 0, 1, 2, 3, 987654321};
+    auto typedData = TypedData::From(1, data);
+
+    auto plain = typedData.convert(DataType::DOUBLE);
+    std::vector<double> plainValues(data.size());
+    std::memcpy(plainValues.data(), plain.buffer().data(), plain.buffer().size());
+    for (size_t i = 0; i < data.size(); i++) {
+        ASSERT_EQ(plainValues[i], static_cast<double>(data[i]));
+    }
+
+    // Normalized in double precision, exact beyond what a float holds
+    auto normalized = typedData.convert(DataType::DOUBLE, true);
+    std::vector<double> normalizedValues(data.size());
+    std::memcpy(normalizedValues.data(), normalized.buffer().data(), normalized.buffer().size());
+    for (size_t i = 0; i < data.size(); i++) {
+        ASSERT_DOUBLE_EQ(normalizedValues[i], std::max(data[i] / 2147483647.0, -1.0));
+    }
+    ASSERT_NE(normalizedValues[2], static_cast<double>(123456789 / 2147483647.0f));
+}
+
+TEST(MeshData, DataViewCopyNormalized) {
+    std::vector<uint16_t> data{0, 65535, 13107, 26214, 39321, 52428, 65535, 0, 0, 65535};
+    auto typedData = TypedData::From(2, data);
+    auto uvs = NormalizedView<glm::vec2>{typedData}.materialize();
+    ASSERT_EQ(uvs.size(), 5);
+    for (size_t i = 0; i < data.size(); i++) {
+        ASSERT_FLOAT_EQ(uvs[i / 2][i % 2], data[i] / 65535.0f);
+    }
+}
+
 TEST(MeshData, DataViewAlgorithms) {
     std::vector<uint32_t> data{0, 5, 3, 9, 2, 7};
     std::vector<unsigned char> raw;
@@ -225,6 +370,58 @@ TEST(MeshData, Copy) {
     }
 }
 
+TEST(MeshData, CopyOnWrite) {
+    auto typedData = TypedData::From(1, std::vector<uint32_t>{0, 1, 2, 3});
+    auto copy = typedData;
+    ASSERT_TRUE(copy.shared());
+    ASSERT_EQ(copy.buffer().data(), typedData.buffer().data());
+
+    // Reading doesn't copy
+    const auto& constCopy = copy;
+    ASSERT_EQ(*((const uint32_t*) constCopy[2].begin()), 2);
+    ASSERT_TRUE(copy.shared());
+
+    // Writing does, and leaves the original unchanged
+    *((uint32_t*) copy[2].begin()) = 7;
+    ASSERT_FALSE(copy.shared());
+    ASSERT_FALSE(typedData.shared());
+    ASSERT_NE(copy.buffer().data(), typedData.buffer().data());
+    ASSERT_EQ(DataView<uint32_t>{copy}[2], 7);
+    ASSERT_EQ(DataView<uint32_t>{typedData}[2], 2);
+    ASSERT_GE(copy.buffer().capacity(), copy.buffer().size() + TypedData::TAIL_PADDING);
+
+    auto appended = typedData;
+    appended.append(typedData);
+    ASSERT_EQ(appended.size(), 8);
+    ASSERT_EQ(typedData.size(), 4);
+}
+
+TEST(MeshData, MovedFrom) {
+    auto typedData = TypedData::From(2, std::vector<uint16_t>{0, 1, 2, 3});
+    const auto* buffer = typedData.buffer().data();
+    auto moved = std::move(typedData);
+    ASSERT_EQ(moved.buffer().data(), buffer);
+    ASSERT_EQ(moved.size(), 2);
+
+    // Empty, with the same layout, and usable again
+    ASSERT_EQ(typedData.size(), 0);
+    ASSERT_TRUE(typedData.buffer().empty());
+    ASSERT_EQ(typedData.dataType(), DataType::U_SHORT);
+    ASSERT_EQ(typedData.componentCount(), 2);
+    ASSERT_EQ(typedData.convert(DataType::FLOAT).size(), 0);
+    typedData.append(moved);
+    ASSERT_EQ(typedData.size(), 2);
+    ASSERT_EQ(((const uint16_t*) typedData.buffer().data())[3], 3);
+
+    TypedData assigned;
+    assigned = std::move(moved);
+    ASSERT_EQ(assigned.size(), 2);
+    ASSERT_EQ(moved.size(), 0);
+    moved.append(assigned);
+    ASSERT_EQ(moved.size(), 2);
+    ASSERT_EQ(assigned.size(), 2);
+}
+
 TEST(MeshData, FromBuiltIn) {
     std::vector<uint32_t> data{0, 1, 2, 3, 4, 5};
     auto typedData = TypedData::From(1, data);
@@ -244,3 +441,9 @@ TEST(MeshData, FromUserDefined) {
         ASSERT_EQ(*((glm::vec3*) typedData[i].begin()), data[i]);
     }
 }
+
+TEST(MeshData, TailPadding) {
+    auto typedData = TypedData::From(DataType::FLOAT, 3, std::vector<float>{0, 1, 2, 3, 4, 5});
+    ASSERT_EQ(typedData.size(), 2);
+    ASSERT_GE(typedData.buffer().capacity(), typedData.buffer().size() + TypedData::TAIL_PADDING);
+}
@@ -45,7 +45,7 @@ TEST(MeshGroup, MergeTwo) {
     }
 
     for (size_t i = 0; i < meshGroup.meshes()[0]->vertexAttribute<glm::vec3>(AttributeType::POSITION).size(); i++) {
-        auto& pos = meshGroup.meshes()[0]->vertexAttribute<glm::vec3>(AttributeType::POSITION)[i];
+        auto pos = meshGroup.meshes()[0]->vertexAttribute<glm::vec3>(AttributeType::POSITION)[i];
         ASSERT_EQ(i * 3 + 1, pos.x);
         ASSERT_EQ(i * 3 + 2, pos.y);
         ASSERT_EQ(i * 3 + 3, pos.z);
@@ -86,8 +86,8 @@ TEST(MeshGroup, MergeMultipleVertexAttibutes) {
     }
 
     for (size_t i = 0; i < meshGroup.meshes()[0]->vertexAttribute<glm::vec3>(AttributeType::POSITION).size(); i++) {
-        auto& pos = meshGroup.meshes()[0]->vertexAttribute<glm::vec3>(AttributeType::POSITION)[i];
-        auto& uv = meshGroup.meshes()[0]->vertexAttribute<glm::vec2>(AttributeType::TEXCOORD)[i];
+        auto pos = meshGroup.meshes()[0]->vertexAttribute<glm::vec3>(AttributeType::POSITION)[i];
+        auto uv = meshGroup.meshes()[0]->vertexAttribute<glm::vec2>(AttributeType::TEXCOORD)[i];
         ASSERT_EQ(i * 3 + 1, pos.x);
         ASSERT_EQ(i * 3 + 2, pos.y);
         ASSERT_EQ(i * 3 + 3, pos.z);
@@ -95,3 +95,23 @@ TEST(MeshGroup, MergeMultipleVertexAttibutes) {
         ASSERT_EQ(i * 2 + 2, uv.t);
     }
 }
+
+TEST(MeshGroup, MergeKeepsOriginals) {
+    std::vector<std::shared_ptr<Mesh>> meshes;
+    for (int i = 0; i < 2; i++) {
+        VertexData vertexData;
+        vertexData[AttributeType::POSITION] = TypedData::From(3, std::vector<float>{1, 2, 3, 4, 5, 6});
+        meshes.push_back(std::make_shared<Mesh>("mesh", -1, TypedData::From(1, std::vector<uint16_t>{0, 1}), std::move(vertexData)));
+    }
+    auto original = meshes[0];
+
+    MeshGroup meshGroup{"group", meshes};
+    meshGroup.merge(true);
+    ASSERT_EQ(meshGroup.meshes().size(), 1);
+    ASSERT_EQ(meshGroup.meshes()[0]->indices().size(), 4);
+
+    // The first mesh may be used elsewhere, so it isn't merged into
+    ASSERT_NE(meshGroup.meshes()[0], original);
+    ASSERT_EQ(original->indices().size(), 2);
+    ASSERT_EQ(original->vertexAttribute(AttributeType::POSITION).size(), 2);
+}
@@ -1,8 +1,12 @@
 #include <test.hpp>
 
+#include <meshtools/image.hpp>
 #include <meshtools/models/model.hpp>
 
+#include <algorithm>
 #include <filesystem>
+#include <memory>
+#include <string>
 
 using namespace meshtools::models;
 
@@ -25,3 +29,97 @@ TEST(Model, Merge) {
     ASSERT_EQ(model1.meshGroups().size(), 2);
     ASSERT_EQ(model1.meshes(0, false).size(), 2);
 }
+
+TEST(Model, Instances) {
+    std::vector<MeshGroup> meshGroups;
+    for (auto name : {"group-1", "group-2"}) {
+        VertexData vertexData;
+        vertexData[AttributeType::POSITION] = TypedData::From(3, std::vector<float>{1, 2, 3});
+        meshGroups.emplace_back(name,
+                                std::make_shared<Mesh>(name, -1, TypedData::From(1, std::vector<uint16_t>{0}), std::move(vertexData)));
+    }
+
+    const auto translation = glm::translate(glm::mat4{1}, glm::vec3{1, 0, 0});
+    std::vector<Node> nodes;
+    nodes.emplace_back(0, Extra{}, translation);
+    nodes[0].children().emplace_back(0, Extra{}, translation);
+    nodes[0].children().emplace_back(std::nullopt);
+    nodes[0].children()[1].children().emplace_back(1);
+    nodes.emplace_back(1);
+
+    Model model{std::move(meshGroups), std::move(nodes)};
+    auto instances = model.instances(0);
+
+    ASSERT_EQ(instances.size(), 4);
+    ASSERT_EQ(instances[0].meshGroup, 0);
+    ASSERT_EQ(instances[0].transform, translation);
+    ASSERT_EQ(instances[1].meshGroup, 0);
+    ASSERT_EQ(instances[1].transform, translation * translation);
+    ASSERT_EQ(instances[2].meshGroup, 1);
+    ASSERT_EQ(instances[2].transform, translation);
+    ASSERT_EQ(instances[3].meshGroup, 1);
+    ASSERT_EQ(instances[3].transform, glm::mat4{1});
+}
+
+TEST(Model, LoadInterleaved) {
+    // Positions and normals in a single buffer view with a byte stride
+    auto modelResult = Model::Load(getFixturesPath("models/interleaved.gltf"));
+    ASSERT_TRUE(modelResult);
+    const auto& mesh = *modelResult.value->meshGroups()[0].meshes()[0];
+
+    auto positions = mesh.vertexAttribute<glm::vec3>(AttributeType::POSITION);
+    ASSERT_EQ(positions.size(), 3);
+    ASSERT_EQ(positions[0], glm::vec3(0, 0, 0));
+    ASSERT_EQ(positions[1], glm::vec3(1, 0, 0));
+    ASSERT_EQ(positions[2], glm::vec3(0, 1, 0));
+
+    auto normals = mesh.vertexAttribute<glm::vec3>(AttributeType::NORMAL);
+    ASSERT_EQ(normals.size(), 3);
+    ASSERT_EQ(normals[0], glm::vec3(0, 0, 1));
+    ASSERT_EQ(normals[1], glm::vec3(0, 0.6f, 0.8f));
+    ASSERT_EQ(normals[2], glm::vec3(1, 0, 0));
+
+    ASSERT_EQ(mesh.indices<uint16_t>().materialize(), (std::vector<uint16_t>{2, 1, 0}));
+}
+
+TEST(Model, GenerateIndices) {
+    auto modelResult = Model::Load(getFixturesPath("models/no-indices.gltf"));
+    ASSERT_TRUE(modelResult);
+    const auto& mesh = *modelResult.value->meshGroups()[0].meshes()[0];
+
+    ASSERT_EQ(mesh.indices().dataType(), DataType::U_INT);
+    ASSERT_EQ(mesh.indices<uint32_t>().materialize(), (std::vector<uint32_t>{0, 1, 2, 3, 4, 5}));
+}
+
+TEST(Model, KTX2RoundTrip) {
+    auto modelResult = Model::Load(getFixturesPath("models/basic.gltf"));
+    ASSERT_TRUE(modelResult);
+    auto& model = *modelResult.value;
+
+    meshtools::Image image(8, 8, 1);
+    std::fill(image.data().begin(), image.data().end(), 200);
+    model.images().push_back(std::make_shared<meshtools::Image>(image.ktx2()));
+    model.textures().push_back({-1, static_cast<int>(model.images().size() - 1)});
+    const int textureIdx = static_cast<int>(model.textures().size() - 1);
+
+    // Loading keeps the image a KTX2 one, so writing it again references it through the extension
+    auto binary = model.binary();
+    auto reloaded = Model::Load(std::string(binary.begin(), binary.end()), true);
+    ASSERT_TRUE(reloaded);
+    const auto& reloadedImage = *reloaded.value->images().back();
+    ASSERT_EQ(reloadedImage.type(), meshtools::Image::Type::KTX2);
+    ASSERT_EQ(reloadedImage.data(), model.images().back()->data());
+    ASSERT_EQ(reloaded.value->textures()[textureIdx].source, static_cast<int>(reloaded.value->images().size() - 1));
+
+    // Written as KTX2 with the extension again, not as a JPG
+    auto text = reloaded.value->text();
+    ASSERT_NE(text.find("image/ktx2"), std::string::npos);
+    ASSERT_EQ(text.find("image/jpeg"), std::string::npos);
+    ASSERT_NE(text.find("KHR_texture_basisu"), std::string::npos);
+    ASSERT_NE(text.find("extensionsRequired"), std::string::npos);
+
+    auto again = Model::Load(text, false);
+    ASSERT_TRUE(again);
+    ASSERT_EQ(again.value->images().back()->type(), meshtools::Image::Type::KTX2);
+    ASSERT_EQ(again.value->textures()[textureIdx].source, static_cast<int>(again.value->images().size() - 1));
+}
@@ -0,0 +1,74 @@
+#include <test.hpp>
+
+#include <meshtools/models/vertex_data.hpp>
+
+#include <algorithm>
+#include <vector>
+
+using namespace meshtools::models;
+
+TEST(VertexData, Ordered) {
+    VertexData vertexData;
+    vertexData[AttributeType{"_CUSTOM_0"}] = TypedData::From(1, std::vector<float>{3});
+    vertexData[AttributeType::TEXCOORD] = TypedData::From(2, std::vector<float>{1, 2});
+    vertexData.emplace(AttributeType::POSITION, TypedData::From(3, std::vector<float>{0, 0, 0}));
+
+    ASSERT_EQ(vertexData.size(), 3);
+    std::vector<AttributeType> order;
+    for (const auto& va : vertexData) {
+        order.push_back(va.first);
+    }
+    ASSERT_EQ(order, (std::vector<AttributeType>{AttributeType::POSITION, AttributeType::TEXCOORD, AttributeType{"_CUSTOM_0"}}));
+
+    // Existing data is kept by emplace and replaced by assignment
+    ASSERT_FALSE(vertexData.emplace(AttributeType::POSITION, TypedData::From(3, std::vector<float>{})).second);
+    ASSERT_EQ(vertexData[AttributeType::POSITION].size(), 1);
+    vertexData[AttributeType::POSITION] = TypedData::From(3, std::vector<float>{});
+    ASSERT_EQ(vertexData[AttributeType::POSITION].size(), 0);
+}
+
+TEST(VertexData, FindErase) {
+    VertexData vertexData;
+    vertexData[AttributeType::NORMAL] = TypedData::From(3, std::vector<float>{0, 0, 1});
+    ASSERT_TRUE(vertexData.find(AttributeType::NORMAL) != vertexData.end());
+    ASSERT_TRUE(vertexData.find(AttributeType::POSITION) == vertexData.end());
+
+    ASSERT_EQ(vertexData.erase(AttributeType::POSITION), 0);
+    ASSERT_EQ(vertexData.erase(AttributeType::NORMAL), 1);
+    ASSERT_TRUE(vertexData.empty());
+}
+
+TEST(VertexData, CommonAndCustom) {
+    const std::vector<AttributeType> attributes{AttributeType{"_CUSTOM_1"}, AttributeType::COLOR, AttributeType{"WEIGHTS_1"},
+                                                AttributeType::POSITION, AttributeType{"_CUSTOM_0"}, AttributeType::NORMAL};
+    VertexData vertexData;
+    for (size_t i = 0; i < attributes.size(); i++) {
+        vertexData[attributes[i]] = TypedData::From(1, std::vector<float>(i + 1));
+    }
+
+    for (size_t i = 0; i < attributes.size(); i++) {
+        auto it = vertexData.find(attributes[i]);
+        ASSERT_TRUE(it != vertexData.end());
+        ASSERT_EQ(it->first, attributes[i]);
+        ASSERT_EQ(it->second.size(), i + 1);
+    }
+    ASSERT_TRUE(vertexData.find(AttributeType::TEXCOORD) == vertexData.end());
+    ASSERT_TRUE(vertexData.find(AttributeType{"_CUSTOM_2"}) == vertexData.end());
+
+    // Erasing and inserting common attributes moves the ones after them
+    ASSERT_EQ(vertexData.erase(AttributeType::POSITION), 1);
+    vertexData[AttributeType::TEXCOORD] = TypedData::From(1, std::vector<float>(10));
+    ASSERT_EQ(vertexData[AttributeType::NORMAL].size(), 6);
+    ASSERT_EQ(vertexData[AttributeType::TEXCOORD].size(), 10);
+    ASSERT_EQ(vertexData[AttributeType::COLOR].size(), 2);
+    ASSERT_EQ(vertexData[AttributeType{"WEIGHTS_1"}].size(), 3);
+    ASSERT_EQ(vertexData[AttributeType{"_CUSTOM_0"}].size(), 5);
+    ASSERT_TRUE(vertexData.find(AttributeType::POSITION) == vertexData.end());
+
+    std::vector<AttributeType> order;
+    for (const auto& va : vertexData) {
+        order.push_back(va.first);
+    }
+    ASSERT_TRUE(std::is_sorted(order.begin(), order.end()));
+    ASSERT_EQ(order.size(), 6);
+}